@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <communication/CommunicatorOptions.h>
+#include <communication/Messages.h>
+#include <logging/Logger.h>
+
+/**
+ * Measures the latency of a token hop over any of the transports: process 0 sends a PING around the ring of all the
+ * processes, each of which passes it on to its successor right away, and times the laps. The transport is picked by
+ * the same options as Misra83 takes, so comparing two of them takes two runs, e.g.
+ *
+ *     mpirun -np 4 HopBenchmark
+ *     mpirun -np 4 HopBenchmark --rma
+ *     mpirun -np 4 HopBenchmark --rma --busy-poll
+ *     dir=$(mktemp -d); for i in 0 1 2 3; do ./HopBenchmark --sockets $dir 4 & done
+ *
+ * '--laps N' sets the number of timed laps, which are preceded by a tenth as many warm-up ones.
+ */
+
+namespace {
+    /** Sent around instead of a lap number once the benchmark is over */
+    constexpr int32_t LAST_LAP = -1;
+
+    void passOn(ICommunicator& communicator, ProcessId successor, int32_t lap) {
+        communicator.post(MessageType::PING, encodeMessage(TokenMessage {.value = lap}), successor);
+    }
+
+    int32_t receiveLap(ICommunicator& communicator) {
+        return decodeMessage<MessageType::PING>(communicator.receive()).value;
+    }
+}
+
+int main(int argc, char** argv) {
+    auto communicator = createCommunicator(argc, argv);
+    Logger::init(communicator);
+    Logger::registerThread("Main", rang::fg::cyan);
+    const ProcessId me = communicator->getProcessId();
+    const ProcessId processes = communicator->getNumberOfProcesses();
+    const ProcessId successor = (me + 1) % processes;
+    const int option = findOption(argc, argv, "--laps");
+    const int32_t laps = option and option + 1 < argc ? std::stoi(argv[option + 1]) : 1000;
+    const int32_t warmUpLaps = laps / 10;
+    if (processes < 2 or laps < 1) {
+        throw std::runtime_error("HopBenchmark needs at least 2 processes and 1 lap");
+    }
+
+    if (me != 0) {
+        int32_t lap;
+        do {
+            lap = receiveLap(*communicator);
+            passOn(*communicator, successor, lap);
+        } while (lap != LAST_LAP);
+        Logger::flush();
+        return 0;
+    }
+
+    std::vector<double> hopTimes;
+    for (int32_t lap = 0; lap < warmUpLaps + laps; ++lap) {
+        const auto start = std::chrono::steady_clock::now();
+        passOn(*communicator, successor, lap);
+        if (receiveLap(*communicator) != lap) {
+            throw std::runtime_error("The token has come back from another lap");
+        }
+        if (lap >= warmUpLaps) {
+            const auto lapTime = std::chrono::steady_clock::now() - start;
+            hopTimes.push_back(std::chrono::duration<double, std::micro>(lapTime).count() / processes);
+        }
+    }
+    passOn(*communicator, successor, LAST_LAP);
+    receiveLap(*communicator);
+
+    std::sort(hopTimes.begin(), hopTimes.end());
+    double total = 0;
+    for (double hopTime : hopTimes) {
+        total += hopTime;
+    }
+    Logger::flush();
+    std::printf("%d processes, %d laps: hop latency avg %.2fus, median %.2fus, p99 %.2fus, max %.2fus\n", processes,
+                laps, total / static_cast<double>(hopTimes.size()), hopTimes[hopTimes.size() / 2],
+                hopTimes[hopTimes.size() * 99 / 100], hopTimes.back());
+    return 0;
+}
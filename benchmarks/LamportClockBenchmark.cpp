@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <communication/ICommunicator.h>
+
+/**
+ * Measures the contention on the Lamport clock of a process: a sending thread ticks it, a receiving thread merges
+ * received timestamps into it and a growing number of logging threads read it, as Logger does for every line.
+ * The lock-free clock of ICommunicator is compared with a clock guarded by a recursive mutex, the way
+ * MpiSimpleCommunicator used to keep it. No MPI needed:
+ *
+ *     LamportClockBenchmark [MILLISECONDS_PER_RUN]
+ */
+
+namespace {
+    /** Exposes the clock of ICommunicator, nothing is ever sent */
+    class AtomicClock : public ICommunicator {
+    public:
+
+        Packet send(MessageType, const std::string&, const std::unordered_set<ProcessId>&) override {
+            throw std::logic_error("AtomicClock does not send");
+        }
+
+        Packet receive() override {
+            throw std::logic_error("AtomicClock does not receive");
+        }
+
+        std::optional<Packet> receive(long) override {
+            throw std::logic_error("AtomicClock does not receive");
+        }
+
+        LamportTime tick() {
+            return tickLamportTime();
+        }
+
+        LamportTime merge(LamportTime receivedTime) {
+            return mergeLamportTime(receivedTime);
+        }
+
+        LamportTime read() {
+            return getCurrentLamportTime();
+        }
+    };
+
+    class MutexClock {
+    public:
+
+        LamportTime tick() {
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+            return ++currentLamportTime;
+        }
+
+        LamportTime merge(LamportTime receivedTime) {
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+            currentLamportTime = std::max(receivedTime, currentLamportTime) + 1;
+            return currentLamportTime;
+        }
+
+        LamportTime read() {
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+            return currentLamportTime;
+        }
+
+    private:
+        std::recursive_mutex mutex;
+        LamportTime currentLamportTime = 0;
+    };
+
+    struct Result {
+        double ticksPerSecond;
+        double mergesPerSecond;
+        double readsPerSecond;
+    };
+
+    template <typename Clock>
+    Result run(unsigned loggingThreads, std::chrono::milliseconds duration) {
+        Clock clock;
+        std::atomic<bool> started = false;
+        std::atomic<bool> stopped = false;
+        std::atomic<unsigned long> ticks = 0;
+        std::atomic<unsigned long> merges = 0;
+        std::atomic<unsigned long> reads = 0;
+
+        // Counts locally and publishes once, so that the counters themselves do not contend
+        auto loop = [&](std::atomic<unsigned long>& counter, auto operation) {
+            while (not started.load(std::memory_order_acquire)) { }
+            unsigned long operations = 0;
+            while (not stopped.load(std::memory_order_relaxed)) {
+                operation(operations);
+                ++operations;
+            }
+            counter.fetch_add(operations);
+        };
+        std::vector<std::thread> threads;
+        threads.emplace_back([&]() { loop(ticks, [&](unsigned long) { clock.tick(); }); });
+        threads.emplace_back([&]() {
+            loop(merges, [&](unsigned long operations) { clock.merge(operations); });
+        });
+        for (unsigned i = 0; i < loggingThreads; ++i) {
+            threads.emplace_back([&]() { loop(reads, [&](unsigned long) { clock.read(); }); });
+        }
+
+        started.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(duration);
+        stopped = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(duration).count();
+        return {ticks / seconds, merges / seconds, reads / seconds};
+    }
+
+    void print(const char* name, unsigned loggingThreads, const Result& result) {
+        std::printf("%-7s %7u  %12.1f  %12.1f  %12.1f\n", name, loggingThreads, result.ticksPerSecond / 1e6,
+                    result.mergesPerSecond / 1e6, result.readsPerSecond / 1e6);
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::chrono::milliseconds duration(argc > 1 ? std::stoi(argv[1]) : 500);
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 4u);
+    std::printf("clock   loggers  ticks [M/s]   merges [M/s]  reads [M/s]\n");
+    // The sending and the receiving thread take two of the cores
+    for (unsigned loggingThreads = 0; loggingThreads + 2 <= cores;
+         loggingThreads = loggingThreads ? loggingThreads * 2 : 1) {
+        print("atomic", loggingThreads, run<AtomicClock>(loggingThreads, duration));
+        print("mutex", loggingThreads, run<MutexClock>(loggingThreads, duration));
+    }
+    return 0;
+}
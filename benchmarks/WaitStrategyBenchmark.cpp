@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <communication/Messages.h>
+#include <communication/MpiOptimizedCommunicator.h>
+
+/**
+ * Compares the wait strategies of the timed receive on a PING/PONG hop between two ranks. Process 0 pauses between
+ * the pings, so that process 1 has to wait for every one of them, and measures the round trip - the wake-up latency of
+ * both sides. Both processes report how much of a core they have burned meanwhile. Has to be run with 2 processes:
+ *
+ *     mpirun -np 2 WaitStrategyBenchmark [HOPS [PAUSE_MICROSECONDS]]
+ */
+
+namespace {
+    struct NamedStrategy {
+        const char* name;
+        WaitStrategy strategy;
+    };
+
+    double getProcessCpuSeconds() {
+        timespec time {};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+    }
+
+    Packet receiveOrThrow(MpiOptimizedCommunicator& communicator) {
+        const long timeoutMillis = 10000;
+        auto packet = communicator.receive(timeoutMillis);
+        if (not packet) {
+            throw std::runtime_error("The peer has not answered in 10 seconds");
+        }
+        return std::move(*packet);
+    }
+}
+
+int main(int argc, char** argv) {
+    MpiOptimizedCommunicator communicator(argc, argv, PREPOSTED_RECEIVES);
+    if (communicator.getNumberOfProcesses() != 2) {
+        throw std::runtime_error("WaitStrategyBenchmark has to be run with 2 processes");
+    }
+    const int hops = argc > 1 ? std::stoi(argv[1]) : 2000;
+    const auto pause = std::chrono::microseconds(argc > 2 ? std::stoi(argv[2]) : 500);
+    const ProcessId me = communicator.getProcessId();
+    const ProcessId peer = 1 - me;
+
+    const NamedStrategy strategies[] = {
+            {"spinning", WaitStrategy::spinning()},
+            {"yielding", WaitStrategy::yielding()},
+            {"backingOff", WaitStrategy::backingOff()}
+    };
+    if (me == 0) {
+        std::printf("%d hops, %ldus pause between them\n", hops, static_cast<long>(pause.count()));
+        std::printf("strategy    rtt median  rtt p99     rtt max     cpu rank 0  cpu rank 1\n");
+    }
+    for (const auto& [name, strategy] : strategies) {
+        communicator.setWaitStrategy(strategy);
+        MPI_Barrier(MPI_COMM_WORLD);
+        std::vector<double> roundTrips;
+        const auto start = std::chrono::steady_clock::now();
+        const double startCpu = getProcessCpuSeconds();
+        for (int32_t value = 1; value <= hops; ++value) {
+            if (me == 0) {
+                std::this_thread::sleep_for(pause);
+                const auto sent = std::chrono::steady_clock::now();
+                communicator.post(MessageType::PING, encodeMessage(TokenMessage {.value = value}), peer);
+                receiveOrThrow(communicator);
+                const auto roundTrip = std::chrono::steady_clock::now() - sent;
+                roundTrips.push_back(std::chrono::duration<double, std::micro>(roundTrip).count());
+            } else {
+                const auto ping = decodeMessage<MessageType::PING>(receiveOrThrow(communicator));
+                communicator.post(MessageType::PONG, encodeMessage(ping), peer);
+            }
+        }
+        const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpuShares[2] = {(getProcessCpuSeconds() - startCpu) / wallSeconds * 100, 0};
+        // A collective, as the preposted receives would match a point-to-point message of any tag
+        MPI_Gather(me == 0 ? MPI_IN_PLACE : &cpuShares[0], 1, MPI_DOUBLE, cpuShares, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        if (me == 0) {
+            std::sort(roundTrips.begin(), roundTrips.end());
+            std::printf("%-11s %8.1fus  %8.1fus  %8.1fus  %9.0f%%  %9.0f%%\n", name, roundTrips[roundTrips.size() / 2],
+                        roundTrips[roundTrips.size() * 99 / 100], roundTrips.back(), cpuShares[0], cpuShares[1]);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
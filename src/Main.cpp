@@ -1,14 +1,119 @@
-#include <communication/MpiOptimizedCommunicator.h>
+#include <cstring>
+#include <communication/CommunicatorOptions.h>
+#include <communication/InProcessCommunicator.h>
+#include <communication/CoalescingCommunicator.h>
 #include <communication/CommunicationManager.h>
 #include <processes/Process.h>
 
+std::shared_ptr<ICommunicator> withOptionalLayers(std::shared_ptr<ICommunicator> communicator, int argc, char** argv) {
+    if (findOption(argc, argv, "--coalesce")) {
+        return std::make_shared<CoalescingCommunicator>(std::move(communicator));
+    }
+    return communicator;
+}
+
+/** Parses '--trace DIR', has to be called once the logger is initialized */
+void enableOptionalTrace(int argc, char** argv) {
+    if (int option = findOption(argc, argv, "--trace"); option and option + 1 < argc) {
+        Logger::enableTrace(argv[option + 1]);
+    }
+}
+
+/** Parses '--flight-recorder DIR', has to be called once the logger is initialized */
+void setOptionalFlightRecorderDirectory(ProcessId rank, int argc, char** argv) {
+    if (int option = findOption(argc, argv, "--flight-recorder"); option and option + 1 < argc) {
+        FlightRecorder::init(rank, argv[option + 1]);
+    }
+}
+
+/** Parses '--log-level debug|info|warning|error' */
+void setOptionalLogLevel(int argc, char** argv) {
+    int option = findOption(argc, argv, "--log-level");
+    if (not option or option + 1 >= argc) {
+        return;
+    }
+    const std::map<std::string, LogLevel> levels = {
+            {"debug", LogLevel::DEBUG}, {"info", LogLevel::INFO},
+            {"warning", LogLevel::WARNING}, {"error", LogLevel::ERROR}
+    };
+    auto level = levels.find(argv[option + 1]);
+    if (level == levels.end()) {
+        throw std::runtime_error(util::concat("Unknown log level '", argv[option + 1], "'"));
+    }
+    Logger::setLevel(level->second);
+}
+
+/** Parses '--inbound-queue CAPACITY [block|drop-oldest|spill]' */
+std::shared_ptr<CommunicationManager> createCommunicationManager(std::shared_ptr<ICommunicator> communicator,
+                                                                 int argc, char** argv) {
+    int option = findOption(argc, argv, "--inbound-queue");
+    if (not option or option + 1 >= argc) {
+        return std::make_shared<CommunicationManager>(std::move(communicator));
+    }
+    InboundQueueOptions options {.capacity = std::stoul(argv[option + 1])};
+    if (option + 2 < argc and std::strcmp(argv[option + 2], "drop-oldest") == 0) {
+        options.overflowPolicy = OverflowPolicy::DROP_OLDEST;
+    } else if (option + 2 < argc and std::strcmp(argv[option + 2], "spill") == 0) {
+        options.overflowPolicy = OverflowPolicy::SPILL;
+    }
+    if (options.capacity == 0) {
+        throw std::runtime_error("The inbound queue has to hold at least one packet");
+    }
+    return std::make_shared<CommunicationManager>(std::move(communicator), options);
+}
+
+/**
+ * Simulates the whole ring inside this single binary - every logical process runs on its own set of threads.
+ */
+int runInProcess(ProcessId numberOfProcesses, int argc, char** argv) {
+    auto network = std::make_shared<InProcessNetwork>(numberOfProcesses);
+    std::vector<std::shared_ptr<ICommunicator>> communicators;
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        communicators.push_back(std::make_shared<InProcessCommunicator>(network, id));
+    }
+    Logger::init(communicators.front());
+    Logger::setColorsEnabled(true);
+    setOptionalLogLevel(argc, argv);
+    enableOptionalTrace(argc, argv);
+    setOptionalFlightRecorderDirectory(communicators.front()->getProcessId(), argc, argv);
+
+    std::vector<std::thread> processThreads;
+    for (const auto& communicator : communicators) {
+        processThreads.emplace_back([communicator, argc, argv]() {
+            auto loggerContext = std::make_shared<Logger::Context>();
+            loggerContext->communicator = communicator;
+            Logger::setContext(loggerContext);
+            Logger::registerThread("Main", rang::fg::cyan);
+            // The optional layers are created once the context is bound, so that their threads log as this process
+            auto communicationManager = createCommunicationManager(withOptionalLayers(communicator, argc, argv),
+                                                                   argc, argv);
+
+            Process process(communicationManager);
+            communicationManager->listen();
+
+            process.run();
+        });
+    }
+    for (auto& thread : processThreads) {
+        thread.join();
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
-    auto communicator = std::make_shared<MpiOptimizedCommunicator>(argc, argv);
+    if (int option = findOption(argc, argv, "--in-process"); option and option + 1 < argc) {
+        return runInProcess(std::stoi(argv[option + 1]), argc, argv);
+    }
+
+    auto communicator = withOptionalLayers(createCommunicator(argc, argv), argc, argv);
     Logger::init(communicator);
     Logger::registerThread("Main", rang::fg::cyan);
     Logger::setColorsEnabled(true);
+    setOptionalLogLevel(argc, argv);
+    enableOptionalTrace(argc, argv);
+    setOptionalFlightRecorderDirectory(communicator->getProcessId(), argc, argv);
 
-    auto communicationManager= std::make_shared<CommunicationManager>(communicator);
+    auto communicationManager = createCommunicationManager(communicator, argc, argv);
 
     Process process(communicationManager);
     communicationManager->listen();
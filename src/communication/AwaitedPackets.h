@@ -0,0 +1,150 @@
+#ifndef INC_3PC_AWAITEDPACKETS_H
+#define INC_3PC_AWAITEDPACKETS_H
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <optional>
+#include <logging/Logger.h>
+#include <util/Scheduler.h>
+#include <util/StringConcat.h>
+#include "ICommunicator.h"
+
+using PacketPredicate = std::function<bool(const Packet&)>;
+
+/** Number of packets kept for the coroutines which have not asked for them yet, the oldest ones are dropped beyond */
+#define AWAITED_PACKETS_UNCLAIMED_CAPACITY 1024
+
+/**
+ * Hands received packets over to the coroutines of a Scheduler awaiting them. Packets which nobody awaits yet are kept
+ * until some coroutine asks for them, up to a capacity. Everything but the constructor has to be called on the thread of the scheduler.
+ */
+class AwaitedPackets {
+
+    struct Waiter;
+
+public:
+
+    /** Resumes the awaiting coroutine with the first matching packet, or with nullopt once the timeout passes */
+    class Awaiter {
+    public:
+
+        Awaiter(AwaitedPackets& packets, PacketPredicate predicate, std::optional<std::chrono::milliseconds> timeout)
+                : packets(packets), waiter(std::make_shared<Waiter>(Waiter {.predicate = std::move(predicate)})),
+                  timeout(timeout) { }
+
+        bool await_ready() {
+            waiter->packet = packets.takeUnclaimed(waiter->predicate);
+            return waiter->packet.has_value();
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) {
+            waiter->coroutine = coroutine;
+            packets.waiters.push_back(waiter);
+            if (timeout) {
+                packets.scheduler.schedule(std::chrono::steady_clock::now() + *timeout,
+                                           [&packets = packets, waiter = waiter]() { packets.expire(waiter); });
+            }
+        }
+
+        std::optional<Packet> await_resume() {
+            return std::move(waiter->packet);
+        }
+
+    protected:
+
+        AwaitedPackets& packets;
+        std::shared_ptr<Waiter> waiter;
+        std::optional<std::chrono::milliseconds> timeout;
+    };
+
+    /** Waits for as long as it takes, so there is always a packet */
+    class PacketAwaiter : public Awaiter {
+    public:
+
+        using Awaiter::Awaiter;
+
+        Packet await_resume() {
+            return std::move(*waiter->packet);
+        }
+    };
+
+    explicit AwaitedPackets(Scheduler& scheduler, std::size_t capacity = AWAITED_PACKETS_UNCLAIMED_CAPACITY)
+            : scheduler(scheduler), capacity(capacity) { }
+
+    PacketAwaiter next(PacketPredicate predicate) {
+        return PacketAwaiter(*this, std::move(predicate), std::nullopt);
+    }
+
+    Awaiter nextIf(PacketPredicate predicate, std::chrono::milliseconds timeout) {
+        return Awaiter(*this, std::move(predicate), timeout);
+    }
+
+    /** Resumes the longest waiting coroutine which the packet matches */
+    void deliver(Packet packet) {
+        for (auto waiter = waiters.begin(); waiter != waiters.end(); ++waiter) {
+            if ((*waiter)->predicate(packet)) {
+                std::shared_ptr<Waiter> matched = std::move(*waiter);
+                waiters.erase(waiter);
+                matched->packet = std::move(packet);
+                matched->coroutine.resume();
+                return;
+            }
+        }
+        if (unclaimed.size() == capacity) {
+            unclaimed.pop_front();
+            if (droppedPackets++ % capacity == 0) {
+                Logger::log<LogLevel::WARNING>([&]() {
+                    return util::concat("Nobody awaits the packets, dropped ", droppedPackets, " of them so far");
+                });
+            }
+        }
+        unclaimed.push_back(std::move(packet));
+    }
+
+    /** Number of the unclaimed packets dropped so far to stay within the capacity */
+    unsigned long getDroppedPackets() const {
+        return droppedPackets;
+    }
+
+private:
+
+    struct Waiter {
+        PacketPredicate predicate;
+        std::coroutine_handle<> coroutine;
+        std::optional<Packet> packet;
+    };
+
+    std::optional<Packet> takeUnclaimed(const PacketPredicate& predicate) {
+        for (auto packet = unclaimed.begin(); packet != unclaimed.end(); ++packet) {
+            if (predicate(*packet)) {
+                Packet taken = std::move(*packet);
+                unclaimed.erase(packet);
+                return taken;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** Resumes the coroutine empty-handed, unless a packet has already been delivered to it */
+    void expire(const std::shared_ptr<Waiter>& waiter) {
+        for (auto candidate = waiters.begin(); candidate != waiters.end(); ++candidate) {
+            if (*candidate == waiter) {
+                waiters.erase(candidate);
+                waiter->coroutine.resume();
+                return;
+            }
+        }
+    }
+
+    Scheduler& scheduler;
+    std::list<std::shared_ptr<Waiter>> waiters;
+    std::deque<Packet> unclaimed;
+    std::size_t capacity;
+    unsigned long droppedPackets = 0;
+};
+
+#endif //INC_3PC_AWAITEDPACKETS_H
@@ -0,0 +1,315 @@
+#include "CoalescingCommunicator.h"
+#include <cstring>
+#include <stdexcept>
+#include <logging/Logger.h>
+#include <util/StringConcat.h>
+
+namespace {
+    // Every record of a BATCH packet is laid out as: lamport time, message type, message length, message
+    using RecordLamportTime = uint64_t;
+    using RecordMessageType = uint8_t;
+    using RecordMessageLength = uint32_t;
+    constexpr std::size_t recordHeaderSize =
+            sizeof(RecordLamportTime) + sizeof(RecordMessageType) + sizeof(RecordMessageLength);
+}
+
+CoalescingCommunicator::CoalescingCommunicator(std::shared_ptr<ICommunicator> communicator, CoalescingWindow window)
+        : communicator(std::move(communicator)), window(window) {
+    myProcessId = this->communicator->getProcessId();
+    numberOfProcesses = this->communicator->getNumberOfProcesses();
+    // Bound to the logger context of the constructing thread, which is the one of the process in the in-process mode
+    flushingThread = std::thread([this, loggerContext = Logger::getContext()]() {
+        Logger::setContext(loggerContext);
+        Logger::registerThread("Coal");
+        flushingThreadFunction();
+    });
+}
+
+CoalescingCommunicator::~CoalescingCommunicator() {
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        terminate = true;
+    }
+    batchesCond.notify_one();
+    flushingThread.join();
+    flush();
+}
+
+Packet CoalescingCommunicator::send(MessageType messageType, const std::string& message,
+                                    const std::unordered_set<ProcessId>& recipients) {
+    LamportTime lamportTime;
+    bool flushed = false;
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        lamportTime = tickLamportTime();
+        for (ProcessId recipient : recipients) {
+            flushed |= enqueue(recipient, lamportTime, messageType, message);
+        }
+    }
+    if (flushed) {
+        sendOutgoing();
+    }
+    return Packet {
+            .lamportTime = lamportTime,
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+Packet CoalescingCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient) {
+    return Packet {
+            .lamportTime = post(messageType, message, &recipient, 1),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+Packet CoalescingCommunicator::sendOthers(MessageType messageType, const std::string& message) {
+    LamportTime lamportTime;
+    bool flushed = false;
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        lamportTime = tickLamportTime();
+        for (ProcessId recipient = 0; recipient < numberOfProcesses; ++recipient) {
+            if (recipient != myProcessId) {
+                flushed |= enqueue(recipient, lamportTime, messageType, message);
+            }
+        }
+    }
+    if (flushed) {
+        sendOutgoing();
+    }
+    return Packet {
+            .lamportTime = lamportTime,
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+LamportTime CoalescingCommunicator::post(MessageType messageType, std::string_view message,
+                                         const ProcessId* recipients, std::size_t numberOfRecipients) {
+    LamportTime lamportTime;
+    bool flushed = false;
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        lamportTime = tickLamportTime();
+        for (std::size_t i = 0; i < numberOfRecipients; ++i) {
+            flushed |= enqueue(recipients[i], lamportTime, messageType, message);
+        }
+    }
+    if (flushed) {
+        sendOutgoing();
+    }
+    return lamportTime;
+}
+
+bool CoalescingCommunicator::enqueue(ProcessId recipient, LamportTime lamportTime, MessageType messageType,
+                                     std::string_view message) {
+    Batch& batch = batches[recipient];
+    bool flushed = false;
+    if (batch.numberOfPackets > 0 and batch.records.size() + recordHeaderSize + message.size() > window.maxBatchBytes) {
+        // The packet would not fit, so the batch leaves without it
+        ++statistics.batchesFlushedBySize;
+        flush(recipient, batch);
+        flushed = true;
+    }
+    if (batch.numberOfPackets == 0) {
+        batch.deadline = std::chrono::steady_clock::now() + window.delay;
+        batchesCond.notify_one();
+    }
+
+    const auto recordLamportTime = static_cast<RecordLamportTime>(lamportTime);
+    const auto recordMessageType = static_cast<RecordMessageType>(messageType);
+    const auto recordMessageLength = static_cast<RecordMessageLength>(message.size());
+    const std::size_t offset = batch.records.size();
+    batch.records.resize(offset + recordHeaderSize + message.size());
+    char* record = batch.records.data() + offset;
+    std::memcpy(record, &recordLamportTime, sizeof(recordLamportTime));
+    std::memcpy(record + sizeof(recordLamportTime), &recordMessageType, sizeof(recordMessageType));
+    std::memcpy(record + sizeof(recordLamportTime) + sizeof(recordMessageType), &recordMessageLength,
+                sizeof(recordMessageLength));
+    message.copy(record + recordHeaderSize, message.size());
+    ++batch.numberOfPackets;
+
+    if (batch.numberOfPackets >= window.maxBatchPackets or batch.records.size() >= window.maxBatchBytes) {
+        ++statistics.batchesFlushedBySize;
+        flush(recipient, batch);
+        flushed = true;
+    }
+    return flushed;
+}
+
+void CoalescingCommunicator::flush(ProcessId recipient, Batch& batch) {
+    if (batch.numberOfPackets == 0) {
+        return;
+    }
+    ++statistics.batchesSent;
+    statistics.packetsSent += batch.numberOfPackets;
+    statistics.bytesSent += batch.records.size();
+    statistics.maxPacketsInBatch = std::max<unsigned long>(statistics.maxPacketsInBatch, batch.numberOfPackets);
+    std::string records;
+    if (not spareRecords.empty()) {
+        records = std::move(spareRecords.back());
+        spareRecords.pop_back();
+    }
+    records.swap(batch.records);
+    outgoingBatches.push_back(OutgoingBatch {.recipient = recipient, .records = std::move(records)});
+    batch.numberOfPackets = 0;
+}
+
+void CoalescingCommunicator::sendOutgoing() {
+    std::lock_guard<std::mutex> sending(sendingMutex);
+    std::unique_lock<std::mutex> lock(batchesMutex);
+    while (not outgoingBatches.empty()) {
+        sendingBatches.swap(outgoingBatches);
+        lock.unlock();
+        for (const OutgoingBatch& batch : sendingBatches) {
+            communicator->post(MessageType::BATCH, batch.records, batch.recipient);
+        }
+        lock.lock();
+        for (OutgoingBatch& batch : sendingBatches) {
+            batch.records.clear();
+            spareRecords.push_back(std::move(batch.records));
+        }
+        sendingBatches.clear();
+    }
+}
+
+void CoalescingCommunicator::flush() {
+    {
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        for (auto& [recipient, batch] : batches) {
+            flush(recipient, batch);
+        }
+    }
+    sendOutgoing();
+}
+
+void CoalescingCommunicator::flushingThreadFunction() {
+    using namespace std::chrono;
+    auto nextStatistics = steady_clock::now() + seconds(COALESCING_STATISTICS_INTERVAL_SECONDS);
+    std::unique_lock<std::mutex> lock(batchesMutex);
+    while (not terminate) {
+        auto now = steady_clock::now();
+        auto nextWakeUp = nextStatistics;
+        bool flushed = false;
+        for (auto& [recipient, batch] : batches) {
+            if (batch.numberOfPackets == 0) {
+                continue;
+            }
+            if (batch.deadline <= now) {
+                ++statistics.batchesFlushedByTime;
+                flush(recipient, batch);
+                flushed = true;
+            } else {
+                nextWakeUp = std::min(nextWakeUp, batch.deadline);
+            }
+        }
+        if (flushed or now >= nextStatistics) {
+            lock.unlock();
+            if (flushed) {
+                sendOutgoing();
+            }
+            if (now >= nextStatistics) {
+                logStatistics();
+                nextStatistics = now + seconds(COALESCING_STATISTICS_INTERVAL_SECONDS);
+            }
+            lock.lock();
+            continue;
+        }
+        batchesCond.wait_until(lock, nextWakeUp);
+    }
+}
+
+void CoalescingCommunicator::logStatistics() {
+    const CoalescingStatistics current = getStatistics();
+    if (current.batchesSent == 0 and current.batchesReceived == 0) {
+        return;
+    }
+    Logger::log<LogLevel::INFO>([&]() {
+        return util::concat("Coalescing: sent ", current.packetsSent, " packets (", current.bytesSent, " bytes) in ",
+                            current.batchesSent, " batches, ", current.batchesFlushedBySize, " of them full and ",
+                            current.batchesFlushedByTime, " timed out, at most ", current.maxPacketsInBatch,
+                            " packets in one; received ", current.packetsReceived, " packets in ",
+                            current.batchesReceived, " batches");
+    });
+}
+
+Packet CoalescingCommunicator::receive() {
+    while (receivedPackets.empty()) {
+        unpack(communicator->receive());
+    }
+    return takeReceived();
+}
+
+std::optional<Packet> CoalescingCommunicator::receive(long timeoutMillis) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    while (receivedPackets.empty()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        std::optional<Packet> packet = communicator->receive(std::max(0L, static_cast<long>(remaining.count())));
+        if (not packet) {
+            return std::nullopt;
+        }
+        unpack(*packet);
+    }
+    return takeReceived();
+}
+
+void CoalescingCommunicator::unpack(const Packet& packet) {
+    if (packet.messageType != MessageType::BATCH) {
+        // Sent by someone who does not coalesce
+        receivedPackets.push_back(packet);
+        return;
+    }
+    std::size_t offset = 0;
+    std::size_t numberOfPackets = 0;
+    const std::size_t alreadyReceived = receivedPackets.size();
+    while (offset < packet.message.size()) {
+        const char* record = packet.message.data() + offset;
+        RecordLamportTime recordLamportTime;
+        RecordMessageType recordMessageType;
+        RecordMessageLength recordMessageLength = 0;
+        const bool headerFits = recordHeaderSize <= packet.message.size() - offset;
+        if (headerFits) {
+            std::memcpy(&recordLamportTime, record, sizeof(recordLamportTime));
+            std::memcpy(&recordMessageType, record + sizeof(recordLamportTime), sizeof(recordMessageType));
+            std::memcpy(&recordMessageLength, record + sizeof(recordLamportTime) + sizeof(recordMessageType),
+                        sizeof(recordMessageLength));
+        }
+        // A truncated or corrupt batch is dropped as a whole, none of its packets is delivered
+        if (not headerFits or recordMessageLength > packet.message.size() - offset - recordHeaderSize or
+            recordMessageType >= NUMBER_OF_MESSAGE_TYPES or
+            recordMessageType == static_cast<RecordMessageType>(MessageType::BATCH)) {
+            receivedPackets.resize(alreadyReceived);
+            throw std::runtime_error(util::concat("Malformed BATCH packet of ", packet.message.size(),
+                                                  " bytes from process ", packet.source, ", record ", numberOfPackets,
+                                                  " at byte ", offset, " is broken"));
+        }
+        receivedPackets.push_back(Packet {
+                .lamportTime = static_cast<LamportTime>(recordLamportTime),
+                .source = packet.source,
+                .messageType = static_cast<MessageType>(recordMessageType),
+                .message = std::string_view(record + recordHeaderSize, recordMessageLength)
+        });
+        offset += recordHeaderSize + recordMessageLength;
+        ++numberOfPackets;
+    }
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    ++statistics.batchesReceived;
+    statistics.packetsReceived += numberOfPackets;
+}
+
+Packet CoalescingCommunicator::takeReceived() {
+    Packet packet = std::move(receivedPackets.front());
+    receivedPackets.pop_front();
+    packet.lamportTime = mergeLamportTime(packet.lamportTime);
+    return packet;
+}
+
+CoalescingStatistics CoalescingCommunicator::getStatistics() {
+    std::lock_guard<std::mutex> lock(batchesMutex);
+    return statistics;
+}
@@ -0,0 +1,133 @@
+#ifndef INC_3PC_COALESCINGCOMMUNICATOR_H
+#define INC_3PC_COALESCINGCOMMUNICATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ICommunicator.h"
+
+#define COALESCING_DEFAULT_DELAY_MICROS 200
+#define COALESCING_DEFAULT_MAX_BATCH_BYTES 192
+#define COALESCING_DEFAULT_MAX_BATCH_PACKETS 16
+#define COALESCING_STATISTICS_INTERVAL_SECONDS 30
+
+struct CoalescingWindow {
+    /** How long the first packet of a batch may wait for others heading to the same destination */
+    std::chrono::microseconds delay {COALESCING_DEFAULT_DELAY_MICROS};
+    std::size_t maxBatchBytes = COALESCING_DEFAULT_MAX_BATCH_BYTES;
+    std::size_t maxBatchPackets = COALESCING_DEFAULT_MAX_BATCH_PACKETS;
+};
+
+struct CoalescingStatistics {
+    unsigned long batchesSent = 0;
+    unsigned long packetsSent = 0;
+    unsigned long bytesSent = 0;
+    unsigned long batchesFlushedBySize = 0;
+    unsigned long batchesFlushedByTime = 0;
+    unsigned long maxPacketsInBatch = 0;
+    unsigned long batchesReceived = 0;
+    unsigned long packetsReceived = 0;
+};
+
+/**
+ * Opt-in layer on top of any other communicator which batches packets heading to the same destination within a small
+ * time or size window into a single BATCH packet. The receiving side splits the batch back into the original packets,
+ * in order. The layer keeps its own Lamport clock, so the batched packets are timestamped as if they were sent one by one.
+ * Full batches are queued up and sent without holding 'batchesMutex', so packets keep being batched meanwhile.
+ * The statistics are logged every COALESCING_STATISTICS_INTERVAL_SECONDS.
+ */
+class CoalescingCommunicator : public ICommunicator {
+public:
+
+    explicit CoalescingCommunicator(std::shared_ptr<ICommunicator> communicator, CoalescingWindow window = {});
+
+    ~CoalescingCommunicator();
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients) override;
+
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient) override;
+
+    Packet sendOthers(MessageType messageType, const std::string& message) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients) override;
+
+    using ICommunicator::post;
+
+    Packet receive() override;
+
+    std::optional<Packet> receive(long timeoutMillis) override;
+
+    /** Sends all the batches right away */
+    void flush();
+
+    CoalescingStatistics getStatistics();
+
+protected:
+
+    struct Batch {
+        std::string records;
+        std::size_t numberOfPackets = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    /**
+     * Has to be called with 'batchesMutex' held.
+     * @return whether a batch has been flushed, in which case the caller has to call sendOutgoing() after unlocking
+     */
+    bool enqueue(ProcessId recipient, LamportTime lamportTime, MessageType messageType, std::string_view message);
+
+    /** A batch which has left 'batches' and waits in 'outgoingBatches' to be sent */
+    struct OutgoingBatch {
+        ProcessId recipient;
+        std::string records;
+    };
+
+    /** Moves the batch to 'outgoingBatches', has to be called with 'batchesMutex' held */
+    void flush(ProcessId recipient, Batch& batch);
+
+    /**
+     * Sends the batches waiting in 'outgoingBatches', has to be called without 'batchesMutex' held by every thread
+     * which has flushed a batch. Only one thread sends at a time, so the batches leave in the order they were flushed.
+     */
+    void sendOutgoing();
+
+    void flushingThreadFunction();
+
+    void logStatistics();
+
+    /**
+     * Splits an incoming packet into 'receivedPackets'.
+     * @throws std::runtime_error if a record of the batch is truncated or broken, none of its packets is kept then
+     */
+    void unpack(const Packet& packet);
+
+    Packet takeReceived();
+
+    std::shared_ptr<ICommunicator> communicator;
+    CoalescingWindow window;
+    CoalescingStatistics statistics;
+
+    std::unordered_map<ProcessId, Batch> batches;
+    std::vector<OutgoingBatch> outgoingBatches;
+    /** Only touched with 'sendingMutex' held, swapped with 'outgoingBatches' so that both keep their capacity */
+    std::vector<OutgoingBatch> sendingBatches;
+    /** Buffers of the sent batches, reused by the next ones */
+    std::vector<std::string> spareRecords;
+    std::mutex batchesMutex;
+    /** Taken before 'batchesMutex' if both are needed */
+    std::mutex sendingMutex;
+    std::condition_variable batchesCond;
+    bool terminate = false;
+    std::thread flushingThread;
+
+    /** Only touched by the receiving thread */
+    std::deque<Packet> receivedPackets;
+};
+
+#endif //INC_3PC_COALESCINGCOMMUNICATOR_H
@@ -1,66 +1,265 @@
 #ifndef INC_3PC_COMMUNICATIONMANAGER_H
 #define INC_3PC_COMMUNICATIONMANAGER_H
 
+#include <array>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <logging/FlightRecorder.h>
 #include <logging/Logger.h>
 #include <util/StringConcat.h>
 #include <util/Utils.h>
-#include <unordered_map>
+#include <util/WaitStrategy.h>
 #include <functional>
+#include "AwaitedPackets.h"
+#include "Executors.h"
 #include "ICommunicator.h"
+#include "InboundQueue.h"
+#include "Messages.h"
+#include "PendingRequests.h"
 
 using SubscriptionId = std::size_t;
-using SubscriptionPredicate = std::function<bool(const Packet&)>;
+using SubscriptionPredicate = PacketPredicate;
 using SubscriptionCallback = std::function<void(const Packet&)>;
 
+/** How often the dispatching thread logs the statistics of the inbound queue */
+#define INBOUND_STATISTICS_INTERVAL_SECONDS 30
+
 class CommunicationManager {
 public:
 
     explicit CommunicationManager(std::shared_ptr<ICommunicator> communicator) : communicator(
             std::move(communicator)) {};
 
+    /** Packets are handed over from the receiving thread to a dispatching one through a bounded queue */
+    CommunicationManager(std::shared_ptr<ICommunicator> communicator, InboundQueueOptions inboundQueueOptions)
+            : communicator(std::move(communicator)),
+              inboundQueue(std::make_unique<InboundQueue>(inboundQueueOptions)) {};
+
     virtual ~CommunicationManager() {
         terminate = true;
-        if (receivingThread and receivingThread->joinable()) {
-            receivingThread->join();
+        if (inboundQueue) {
+            inboundQueue->close();
+        }
+        for (auto* thread : {&receivingThread, &dispatchingThread}) {
+            if (*thread and (*thread)->joinable()) {
+                (*thread)->join();
+            }
         }
+        delete registry.load();
     }
 
     void listen() {
         if (not receivingThread) {
-            receivingThread = std::make_unique<std::thread>(threadFunction);
+            // The threads log on behalf of the same process as the thread that started listening
+            receivingThread = std::make_unique<std::thread>([this, loggerContext = Logger::getContext()]() {
+                Logger::setContext(loggerContext);
+                threadFunction();
+            });
+            if (inboundQueue) {
+                dispatchingThread = std::make_unique<std::thread>([this, loggerContext = Logger::getContext()]() {
+                    Logger::setContext(loggerContext);
+                    dispatchingThreadFunction();
+                });
+            }
+        }
+    }
+
+    /**
+     * Slow path - the predicate is evaluated for every received packet.
+     * @param executor runs the callback, which is otherwise called inline by the receiving thread
+     */
+    SubscriptionId subscribe(const SubscriptionPredicate& predicate, const SubscriptionCallback& callback,
+                             std::shared_ptr<IExecutor> executor = nullptr) {
+        SubscriptionId id;
+        const SubscriptionRegistry* previous;
+        {
+            std::lock_guard<std::mutex> lock(subscriptionMutex);
+            auto next = std::make_unique<SubscriptionRegistry>(*registry.load());
+            next->subscriptions.emplace_back(subscriptionSeqNo, std::make_pair(predicate, Subscription {
+                    .callback = callback, .executor = std::move(executor),
+                    .state = std::make_shared<SubscriptionState>()}));
+            previous = publish(std::move(next));
+            id = subscriptionSeqNo++;
+        }
+        retire(previous);
+        return id;
+    }
+
+    /** Fast path - packets are dispatched by indexing a table with their type, whatever the number of subscriptions */
+    SubscriptionId subscribe(MessageType messageType, const SubscriptionCallback& callback,
+                             std::shared_ptr<IExecutor> executor = nullptr) {
+        SubscriptionId id;
+        const SubscriptionRegistry* previous;
+        {
+            std::lock_guard<std::mutex> lock(subscriptionMutex);
+            auto next = std::make_unique<SubscriptionRegistry>(*registry.load());
+            next->typedSubscriptions[static_cast<std::size_t>(messageType)].emplace_back(subscriptionSeqNo,
+                    Subscription {.callback = callback, .executor = std::move(executor),
+                                  .state = std::make_shared<SubscriptionState>()});
+            previous = publish(std::move(next));
+            id = subscriptionSeqNo++;
+        }
+        retire(previous);
+        return id;
+    }
+
+    /** Subscribes to a typed message - the callback gets its payload already decoded */
+    template <MessageType type>
+    SubscriptionId subscribe(const std::function<void(const Packet&, const MessagePayload<type>&)>& callback,
+                             std::shared_ptr<IExecutor> executor = nullptr) {
+        return subscribe(type, [callback](const Packet& p) {
+            callback(p, decodeMessage<type>(p));
+        }, std::move(executor));
+    }
+
+    /**
+     * Lets the coroutines of the scheduler await the packets matching the predicate through next() and nextIf().
+     * Matching packets which no coroutine asks for are kept, so the predicate should only let through the ones
+     * the coroutines are going to claim - beyond AWAITED_PACKETS_UNCLAIMED_CAPACITY the oldest are dropped.
+     * The scheduler has to outlive the manager. Awaiting can only be enabled once.
+     */
+    void enableAwaiting(Scheduler& scheduler, const SubscriptionPredicate& predicate) {
+        if (awaitedPackets) {
+            throw std::logic_error("Awaiting has already been enabled");
         }
+        awaitedPackets = std::make_unique<AwaitedPackets>(scheduler);
+        subscribe(predicate, [this, &scheduler](const Packet& packet) {
+            scheduler.post([this, packet]() { awaitedPackets->deliver(packet); });
+        });
     }
 
-    SubscriptionId subscribe(const SubscriptionPredicate& predicate, const SubscriptionCallback& callback) {
+    /**
+     * Usage: Packet ping = co_await manager.next(MessageType::PING);
+     * @throws std::logic_error if enableAwaiting() has not been called
+     */
+    AwaitedPackets::PacketAwaiter next(MessageType messageType) {
+        return getAwaitedPackets().next([messageType](const Packet& p) { return p.messageType == messageType; });
+    }
+
+    /**
+     * Usage: std::optional<Packet> packet = co_await manager.nextIf(predicate, 100ms);
+     * @throws std::logic_error if enableAwaiting() has not been called
+     */
+    AwaitedPackets::Awaiter nextIf(const SubscriptionPredicate& predicate, std::chrono::milliseconds timeout) {
+        return getAwaitedPackets().nextIf(predicate, timeout);
+    }
+
+    /** Executor shared by all the subscriptions which neither need a thread of their own nor may block the receiving one */
+    std::shared_ptr<IExecutor> getWorkerPool() {
         std::lock_guard<std::mutex> lock(subscriptionMutex);
-        subscriptions[subscriptionSeqNo] = {predicate, callback};
-        return subscriptionSeqNo++;
+        if (not workerPool) {
+            workerPool = std::make_shared<WorkerPool>();
+        }
+        return workerPool;
     }
 
+    /**
+     * Once this returns, the callback of the subscription is not running anywhere and is never going to be called
+     * again - unless it is the callback itself which unsubscribes, as it obviously cannot wait for itself to finish.
+     */
     void unsubscribe(SubscriptionId id) {
-        std::lock_guard<std::mutex> lock(subscriptionMutex);
-        subscriptions.erase(id);
+        std::shared_ptr<SubscriptionState> state;
+        const SubscriptionRegistry* previous;
+        {
+            std::lock_guard<std::mutex> lock(subscriptionMutex);
+            auto next = std::make_unique<SubscriptionRegistry>(*registry.load());
+            state = next->remove(id);
+            if (not state) {
+                return;
+            }
+            previous = publish(std::move(next));
+        }
+        retire(previous);
+        // Packets dispatched from the old snapshot may still be queued at an executor, so they check the flag first
+        state->active.store(false, std::memory_order_seq_cst);
+        const unsigned ownCalls = runningSubscription == state.get() ? 1 : 0;
+        WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+            return state->runningCalls.load(std::memory_order_acquire) == ownCalls;
+        });
     }
 
     Packet send(MessageType messageType, const std::string& message, ProcessId recipient) {
-        Logger::log(util::concat("Sending to process ", recipient, " ", printPacket(messageType, message)));
+        Logger::log<LogLevel::DEBUG>([&]() {
+            return util::concat("Sending to process ", recipient, " ", printPacket(messageType, message));
+        });
+        Logger::trace(TraceEvent::SEND, recipient, static_cast<int64_t>(messageType));
         return communicator->send(messageType, message, recipient);
     }
 
     Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients) {
-        Logger::log(util::concat("Sending to processes ", printContainer(recipients), " ",
-                                 printPacket(messageType, message)));
+        Logger::log<LogLevel::DEBUG>([&]() {
+            return util::concat("Sending to processes ", printContainer(recipients), " ",
+                                printPacket(messageType, message));
+        });
+        for (ProcessId recipient : recipients) {
+            Logger::trace(TraceEvent::SEND, recipient, static_cast<int64_t>(messageType));
+        }
         return communicator->send(messageType, message, recipients);
     }
 
     Packet sendOthers(MessageType messageType, const std::string& message) {
-        Logger::log("Sending to other processes " + printPacket(messageType, message));
+        Logger::log<LogLevel::DEBUG>([&]() {
+            return "Sending to other processes " + printPacket(messageType, message);
+        });
+        Logger::trace(TraceEvent::SEND, -1, static_cast<int64_t>(messageType));
         return communicator->sendOthers(messageType, message);
     }
 
+    /** Fire-and-forget send which does not build a copy of the sent Packet */
+    LamportTime post(MessageType messageType, std::string_view message, ProcessId recipient) {
+        Logger::log<LogLevel::DEBUG>([&]() {
+            return util::concat("Sending to process ", recipient, " ", printPacket(messageType, message));
+        });
+        Logger::trace(TraceEvent::SEND, recipient, static_cast<int64_t>(messageType));
+        return communicator->post(messageType, message, recipient);
+    }
+
+    /** Sends a typed message as its raw bytes, without any formatting or heap allocation */
+    template <MessageType type>
+    LamportTime post(const MessagePayload<type>& payload, ProcessId recipient) {
+        return post(type, encodeMessage(payload), recipient);
+    }
+
+    /**
+     * Sends the message wrapped in a REQUEST. The future gets the reply the recipient sends through reply(), or
+     * a std::runtime_error if none arrives in time. Replies go straight to their future, bypassing the subscriptions.
+     */
+    std::future<Packet> request(MessageType messageType, std::string_view message, ProcessId recipient,
+                                std::chrono::milliseconds timeout) {
+        std::future<Packet> reply;
+        const CorrelationId correlationId = pendingRequests.add(recipient, timeout, reply);
+        try {
+            post(MessageType::REQUEST, wrapCorrelated(correlationId, messageType, message), recipient);
+        } catch (...) {
+            pendingRequests.fail(correlationId, std::current_exception());
+            throw;
+        }
+        return reply;
+    }
+
+    template <MessageType type>
+    std::future<Packet> request(const MessagePayload<type>& payload, ProcessId recipient,
+                                std::chrono::milliseconds timeout) {
+        return request(type, encodeMessage(payload), recipient, timeout);
+    }
+
+    /** Answers a request, which subscriptions get unwrapped with its correlation id set */
+    LamportTime reply(const Packet& request, MessageType messageType, std::string_view message) {
+        if (request.correlationId == 0) {
+            throw std::runtime_error(util::concat("Tried to reply to a ", request.messageType,
+                                                  " packet which is not a request"));
+        }
+        return post(MessageType::REPLY, wrapCorrelated(request.correlationId, messageType, message), request.source);
+    }
+
+    template <MessageType type>
+    LamportTime reply(const Packet& request, const MessagePayload<type>& payload) {
+        return reply(request, type, encodeMessage(payload));
+    }
+
     ProcessId getProcessId() {
         return communicator->getProcessId();
     }
@@ -73,42 +272,245 @@ public:
         return communicator->getCurrentLamportTime();
     }
 
+    /** @return nullopt if packets are dispatched straight by the receiving thread */
+    std::optional<InboundStatistics> getInboundStatistics(MessageType messageType) {
+        if (not inboundQueue) {
+            return std::nullopt;
+        }
+        return inboundQueue->getStatistics(messageType);
+    }
+
 protected:
 
     std::function<void()> threadFunction = [&]() {
         Logger::registerThread("Recv", rang::fg::yellow);
         while (not terminate.load()) {
+            communicator->receive([&](const Packet& packet) {
+                if (inboundQueue) {
+                    inboundQueue->push(packet);
+                } else {
+                    dispatch(packet);
+                }
+            });
+        }
+    };
 
-            Packet packet = communicator->receive();
-            Logger::log(util::concat("Received packet from process ", packet.source, " ",
-                                     printPacket(packet.messageType, packet.message)));
-            std::lock_guard<std::mutex> lock(subscriptionMutex);
-            bool anyCallbackInvoked = false;
-            for (const auto& subscription : subscriptions) {
-                const auto&[predicate, callback] = subscription.second;
-                if (predicate(packet)) {
-                    callback(packet);
+    void dispatchingThreadFunction() {
+        Logger::registerThread("Disp", rang::fg::yellow);
+        auto nextStatistics = std::chrono::steady_clock::now() + std::chrono::seconds(INBOUND_STATISTICS_INTERVAL_SECONDS);
+        while (not terminate.load()) {
+            if (std::optional<Packet> packet = inboundQueue->pop(nextStatistics)) {
+                dispatch(*packet);
+            }
+            if (std::chrono::steady_clock::now() >= nextStatistics) {
+                logInboundStatistics();
+                nextStatistics += std::chrono::seconds(INBOUND_STATISTICS_INTERVAL_SECONDS);
+            }
+        }
+    }
+
+    void logInboundStatistics() {
+        for (std::size_t type = 0; type < NUMBER_OF_MESSAGE_TYPES; ++type) {
+            const auto messageType = static_cast<MessageType>(type);
+            InboundStatistics statistics = inboundQueue->getStatistics(messageType);
+            if (statistics.enqueued == 0 and statistics.dropped == 0) {
+                continue;
+            }
+            auto averageLatency = statistics.dispatched ? statistics.totalLatency.count() / statistics.dispatched : 0;
+            Logger::log<LogLevel::INFO>([&]() {
+                return util::concat("Inbound ", messageType, ": depth ", statistics.depth, " (max ",
+                                    statistics.maxDepth, "), dispatched ", statistics.dispatched, ", dropped ",
+                                    statistics.dropped, ", spilled ", statistics.spilled, ", latency avg ",
+                                    averageLatency, "us max ", statistics.maxLatency.count(), "us");
+            });
+        }
+    }
+
+    void dispatch(const Packet& packet) {
+        Logger::log<LogLevel::DEBUG>([&]() {
+            return util::concat("Received packet from process ", packet.source, " ",
+                                printPacket(packet.messageType, packet.message));
+        });
+        Logger::trace(TraceEvent::RECEIVE, packet.source, static_cast<int64_t>(packet.messageType));
+        if (packet.messageType == MessageType::REPLY) {
+            if (not pendingRequests.complete(unwrapCorrelated(packet))) {
+                Logger::log<LogLevel::WARNING>("Dropping a reply to a request which is not pending anymore");
+            }
+        } else if (packet.messageType == MessageType::REQUEST) {
+            dispatchToSubscriptions(unwrapCorrelated(packet));
+        } else {
+            dispatchToSubscriptions(packet);
+        }
+    }
+
+    void dispatchToSubscriptions(const Packet& packet) {
+        // Marks the snapshot as being read, see retire()
+        dispatchEpoch.fetch_add(1, std::memory_order_seq_cst);
+        dispatchingManager = this;
+        bool anyCallbackInvoked = false;
+        {
+            // Ends the dispatch even if an inline callback throws, or retire() would wait for it forever
+            struct Guard {
+                CommunicationManager& manager;
+
+                ~Guard() {
+                    dispatchingManager = nullptr;
+                    manager.dispatchEpoch.fetch_add(1, std::memory_order_release);
+                    // Snapshots replaced by callbacks of this very dispatch could not be deleted while it read them
+                    for (const SubscriptionRegistry* retired : manager.retiredRegistries) {
+                        delete retired;
+                    }
+                    manager.retiredRegistries.clear();
+                }
+            } guard {.manager = *this};
+            const SubscriptionRegistry& snapshot = *registry.load(std::memory_order_seq_cst);
+            const auto& callbacks = snapshot.typedSubscriptions[static_cast<std::size_t>(packet.messageType)];
+            for (const auto& [id, subscription] : callbacks) {
+                invoke(subscription, packet);
+            }
+            anyCallbackInvoked = not callbacks.empty();
+            for (const auto& [id, subscription] : snapshot.subscriptions) {
+                if (subscription.first(packet)) {
+                    invoke(subscription.second, packet);
                     anyCallbackInvoked = true;
                 }
             }
-            if (not anyCallbackInvoked) {
-                auto error = "WARNING! No callback invoked for packet with TS " + std::to_string(packet.lamportTime) +
-                             " " + printPacket(packet.messageType, packet.message);
-                Logger::log(error);
-                throw std::runtime_error(error);
+        }
+        if (not anyCallbackInvoked) {
+            auto error = "WARNING! No callback invoked for packet with TS " + std::to_string(packet.lamportTime) +
+                         " " + printPacket(packet.messageType, packet.message);
+            Logger::log<LogLevel::ERROR>(error);
+            FlightRecorder::dump(error);
+            throw std::runtime_error(error);
+        }
+    }
+
+    /** Outlives the subscription in the snapshots and tasks which still refer to it */
+    struct SubscriptionState {
+        std::atomic<bool> active = true;
+        std::atomic<unsigned> runningCalls = 0;
+    };
+
+    struct Subscription {
+        SubscriptionCallback callback;
+        /** Null for callbacks called inline by the receiving thread */
+        std::shared_ptr<IExecutor> executor;
+        std::shared_ptr<SubscriptionState> state;
+    };
+
+    /** Immutable once published - every change copies the whole registry, as subscriptions are rare */
+    struct SubscriptionRegistry {
+        /** Indexed by the message type */
+        std::array<std::vector<std::pair<SubscriptionId, Subscription>>, NUMBER_OF_MESSAGE_TYPES> typedSubscriptions;
+        std::vector<std::pair<SubscriptionId, std::pair<SubscriptionPredicate, Subscription>>> subscriptions;
+
+        /** @return state of the removed subscription or null if there is none with the id */
+        std::shared_ptr<SubscriptionState> remove(SubscriptionId id) {
+            for (auto subscription = subscriptions.begin(); subscription != subscriptions.end(); ++subscription) {
+                if (subscription->first == id) {
+                    auto state = subscription->second.second.state;
+                    subscriptions.erase(subscription);
+                    return state;
+                }
+            }
+            for (auto& callbacks : typedSubscriptions) {
+                for (auto subscription = callbacks.begin(); subscription != callbacks.end(); ++subscription) {
+                    if (subscription->first == id) {
+                        auto state = subscription->second.state;
+                        callbacks.erase(subscription);
+                        return state;
+                    }
+                }
             }
+            return nullptr;
         }
     };
 
-    static std::string printPacket(MessageType messageType, const std::string& message) {
-        return util::concat("[messageType: ", messageType, ", message: ", message, ']');
+    /**
+     * Has to be called with 'subscriptionMutex' held.
+     * @return the replaced snapshot, which has to be passed to retire() once the mutex is released - an inline callback
+     * of the dispatch retire() waits for may be blocked on the mutex itself
+     */
+    const SubscriptionRegistry* publish(std::unique_ptr<SubscriptionRegistry> next) {
+        return registry.exchange(next.release(), std::memory_order_seq_cst);
+    }
+
+    /** Deletes a replaced snapshot as soon as the dispatching thread cannot be reading it anymore */
+    void retire(const SubscriptionRegistry* previous) {
+        if (dispatchingManager == this) {
+            retiredRegistries.push_back(previous);
+            return;
+        }
+        // An odd epoch means a dispatch is in progress, which may have loaded the previous snapshot
+        const uint64_t epoch = dispatchEpoch.load(std::memory_order_seq_cst);
+        if (epoch % 2) {
+            WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+                return dispatchEpoch.load(std::memory_order_acquire) != epoch;
+            });
+        }
+        delete previous;
+    }
+
+    static void invoke(const Subscription& subscription, const Packet& packet) {
+        if (not subscription.executor) {
+            call(subscription.callback, *subscription.state, packet);
+            return;
+        }
+        subscription.executor->execute(packet.messageType,
+                                       [callback = subscription.callback, state = subscription.state, packet]() {
+            call(callback, *state, packet);
+        });
+    }
+
+    static void call(const SubscriptionCallback& callback, SubscriptionState& state, const Packet& packet) {
+        // Counted before checking the flag, so unsubscribe() either sees the call running or the call sees the flag
+        state.runningCalls.fetch_add(1, std::memory_order_seq_cst);
+        struct Guard {
+            SubscriptionState& state;
+            SubscriptionState* outerSubscription = runningSubscription;
+
+            ~Guard() {
+                runningSubscription = outerSubscription;
+                state.runningCalls.fetch_sub(1, std::memory_order_release);
+            }
+        } guard {.state = state};
+        if (state.active.load(std::memory_order_seq_cst)) {
+            runningSubscription = &state;
+            callback(packet);
+        }
+    }
+
+    AwaitedPackets& getAwaitedPackets() {
+        if (not awaitedPackets) {
+            throw std::logic_error("Packets can only be awaited once enableAwaiting() has been called");
+        }
+        return *awaitedPackets;
+    }
+
+    static std::string printPacket(MessageType messageType, std::string_view message) {
+        return util::concat("[messageType: ", messageType, ", message: ", describeMessage(messageType, message), ']');
     }
 
-    std::unordered_map<SubscriptionId, std::pair<SubscriptionPredicate, SubscriptionCallback>> subscriptions;
+    /** Current snapshot, read without any locking by the dispatching thread */
+    std::atomic<const SubscriptionRegistry*> registry = new SubscriptionRegistry();
+    /** Odd while a dispatch is in progress */
+    std::atomic<uint64_t> dispatchEpoch = 0;
+    /** Only touched by the dispatching thread */
+    std::vector<const SubscriptionRegistry*> retiredRegistries;
+    static inline thread_local const CommunicationManager* dispatchingManager = nullptr;
+    static inline thread_local SubscriptionState* runningSubscription = nullptr;
+    std::shared_ptr<IExecutor> workerPool;
+    /** Only used by coroutines, see enableAwaiting() */
+    std::unique_ptr<AwaitedPackets> awaitedPackets;
+    PendingRequests pendingRequests;
     SubscriptionId subscriptionSeqNo = 0;
     std::shared_ptr<ICommunicator> communicator;
     std::unique_ptr<std::thread> receivingThread;
+    /** Only used together with the inbound queue */
+    std::unique_ptr<InboundQueue> inboundQueue;
+    std::unique_ptr<std::thread> dispatchingThread;
     std::atomic<bool> terminate = false;
+    /** Only serializes the writers of the registry, the dispatching thread never takes it */
     std::mutex subscriptionMutex;
 };
 
@@ -0,0 +1,41 @@
+#include "CommunicatorOptions.h"
+#include <cstring>
+#include <string>
+#include "MpiOptimizedCommunicator.h"
+#include "MpiProgressCommunicator.h"
+#include "MpiRingCommunicator.h"
+#include "MpiRmaCommunicator.h"
+#include "ShmRingCommunicator.h"
+#include "SocketCommunicator.h"
+
+int findOption(int argc, char** argv, const char* option) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], option) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+std::shared_ptr<ICommunicator> createCommunicator(int argc, char** argv) {
+    if (int option = findOption(argc, argv, "--sockets"); option and option + 2 < argc) {
+        return std::make_shared<SocketCommunicator>(argv[option + 1], std::stoi(argv[option + 2]));
+    }
+    if (int option = findOption(argc, argv, "--shm"); option and option + 2 < argc) {
+        return std::make_shared<ShmRingCommunicator>(argv[option + 1], std::stoi(argv[option + 2]));
+    }
+    if (findOption(argc, argv, "--ring")) {
+        return std::make_shared<MpiRingCommunicator>(argc, argv, findOption(argc, argv, "--topology"));
+    }
+    // Polling transports only keep a core busy when asked to, e.g. to measure the lowest latency
+    const WaitStrategy polling = findOption(argc, argv, "--busy-poll") ?
+                                 WaitStrategy::yielding() :
+                                 WaitStrategy::backingOff(std::chrono::microseconds(POLLING_MAX_SLEEP_MICROS));
+    if (findOption(argc, argv, "--rma")) {
+        return std::make_shared<MpiRmaCommunicator>(argc, argv, polling);
+    }
+    if (findOption(argc, argv, "--progress-thread")) {
+        return std::make_shared<MpiProgressCommunicator>(argc, argv, polling);
+    }
+    return std::make_shared<MpiOptimizedCommunicator>(argc, argv, PREPOSTED_RECEIVES);
+}
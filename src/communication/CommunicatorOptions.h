@@ -0,0 +1,17 @@
+#ifndef INC_3PC_COMMUNICATOROPTIONS_H
+#define INC_3PC_COMMUNICATOROPTIONS_H
+
+#include <memory>
+#include "ICommunicator.h"
+
+/** @return index of the option in argv or 0 if it has not been passed */
+int findOption(int argc, char** argv, const char* option);
+
+/**
+ * Creates the transport picked on the command line: '--sockets DIR N', '--shm DIR N', '--ring [--topology]', '--rma',
+ * '--progress-thread' or MpiOptimizedCommunicator with preposted receives if none of them has been passed.
+ * '--busy-poll' makes '--rma' and '--progress-thread' poll without ever sleeping.
+ */
+std::shared_ptr<ICommunicator> createCommunicator(int argc, char** argv);
+
+#endif //INC_3PC_COMMUNICATOROPTIONS_H
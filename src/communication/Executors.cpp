@@ -0,0 +1,37 @@
+#include "Executors.h"
+
+SerialExecutor::SerialExecutor(std::string threadName, rang::fg consoleColor)
+        : tasks(std::make_shared<Mailbox<ExecutorTask>>()) {
+    thread = std::thread([tasks = tasks, threadName = std::move(threadName), consoleColor,
+                          loggerContext = Logger::getContext()]() {
+        Logger::setContext(loggerContext);
+        Logger::registerThread(threadName, consoleColor);
+        // An empty task asks the thread to finish
+        while (ExecutorTask task = tasks->pop()) {
+            task();
+        }
+    });
+}
+
+SerialExecutor::~SerialExecutor() {
+    tasks->push(ExecutorTask());
+    if (thread.get_id() == std::this_thread::get_id()) {
+        thread.detach();
+    } else {
+        thread.join();
+    }
+}
+
+void SerialExecutor::execute(MessageType, ExecutorTask task) {
+    tasks->push(std::move(task));
+}
+
+WorkerPool::WorkerPool(std::size_t numberOfWorkers) {
+    for (std::size_t i = 0; i < numberOfWorkers; ++i) {
+        workers.push_back(std::make_unique<SerialExecutor>("Pool" + std::to_string(i)));
+    }
+}
+
+void WorkerPool::execute(MessageType messageType, ExecutorTask task) {
+    workers[static_cast<std::size_t>(messageType) % workers.size()]->execute(messageType, std::move(task));
+}
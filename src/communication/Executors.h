@@ -0,0 +1,62 @@
+#ifndef INC_3PC_EXECUTORS_H
+#define INC_3PC_EXECUTORS_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <logging/Logger.h>
+#include <util/Define.h>
+#include <util/Mailbox.h>
+
+/** Number of worker threads of the pool shared by all the subscriptions of a CommunicationManager */
+#define CALLBACK_POOL_SIZE 2
+
+using ExecutorTask = std::function<void()>;
+
+/**
+ * Runs subscription callbacks away from the receiving thread. Tasks of the same message type have to run one after
+ * another in the order they have been submitted.
+ */
+class IExecutor {
+public:
+
+    virtual ~IExecutor() = default;
+
+    virtual void execute(MessageType messageType, ExecutorTask task) = 0;
+};
+
+/** Runs all the tasks, whatever their message type, one by one on a dedicated thread */
+class SerialExecutor : public IExecutor {
+public:
+
+    /** The thread logs under the given name on behalf of the process of the calling thread */
+    explicit SerialExecutor(std::string threadName, rang::fg consoleColor = rang::fg::reset);
+
+    /** Waits for the submitted tasks to finish, unless it is called by one of them */
+    ~SerialExecutor() override;
+
+    void execute(MessageType messageType, ExecutorTask task) override;
+
+private:
+
+    /** Shared with the thread, so that a task may destroy its own executor */
+    std::shared_ptr<Mailbox<ExecutorTask>> tasks;
+    std::thread thread;
+};
+
+/** Spreads the tasks over CALLBACK_POOL_SIZE serial workers, all the tasks of one message type go to the same worker */
+class WorkerPool : public IExecutor {
+public:
+
+    explicit WorkerPool(std::size_t numberOfWorkers = CALLBACK_POOL_SIZE);
+
+    void execute(MessageType messageType, ExecutorTask task) override;
+
+private:
+
+    std::vector<std::unique_ptr<SerialExecutor>> workers;
+};
+
+#endif //INC_3PC_EXECUTORS_H
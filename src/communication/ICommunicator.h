@@ -1,19 +1,27 @@
 #ifndef INC_3PC_ICOMMUNICATOR_H
 #define INC_3PC_ICOMMUNICATOR_H
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <optional>
+#include <string_view>
 #include <unordered_set>
 #include <util/Define.h>
 #include <util/Utils.h>
+#include "PacketPayload.h"
 
 using ProcessId = int;
 using LamportTime = unsigned long;
+using CorrelationId = uint64_t;
 
 struct Packet {
     LamportTime lamportTime;
     ProcessId source;
     MessageType messageType;
-    std::string message;
+    PacketPayload message;
+    /** Only set on unwrapped requests and replies, see CommunicationManager::request() */
+    CorrelationId correlationId = 0;
 
     inline bool operator==(const Packet &other) const {
         return source == other.source && messageType == other.messageType && message == other.message;
@@ -35,6 +43,8 @@ namespace std {
     };
 }
 
+using PacketConsumer = std::function<void(const Packet&)>;
+
 class ICommunicator {
 public:
 
@@ -48,10 +58,33 @@ public:
         return send(messageType, message, otherProcesses);
     };
 
+    /**
+     * Fire-and-forget variant of send() for hot paths. The payload is taken by view and no Packet copy is returned,
+     * so implementations are able to send without any heap allocation.
+     * @return Lamport timestamp the packet has been sent with
+     */
+    virtual LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                             std::size_t numberOfRecipients) {
+        return send(messageType, std::string(message),
+                    std::unordered_set<ProcessId>(recipients, recipients + numberOfRecipients)).lamportTime;
+    }
+
+    LamportTime post(MessageType messageType, std::string_view message, ProcessId recipient) {
+        return post(messageType, message, &recipient, 1);
+    }
+
     virtual Packet receive() = 0;
 
     virtual std::optional<Packet> receive(long timeoutMillis) = 0;
 
+    /**
+     * Receives a single packet and hands it to the consumer. The packet is only valid until the consumer returns,
+     * which lets implementations recycle its storage instead of allocating a new one for every packet.
+     */
+    virtual void receive(const PacketConsumer& consumer) {
+        consumer(receive());
+    }
+
     virtual ProcessId getProcessId() {
         return myProcessId;
     }
@@ -61,18 +94,34 @@ public:
     }
 
     virtual LamportTime getCurrentLamportTime() {
-        return currentLamportTime;
+        return currentLamportTime.load(std::memory_order_relaxed);
     }
 
 protected:
 
+    /** Advances the clock for an outgoing packet. @return timestamp of the packet */
+    LamportTime tickLamportTime() {
+        return currentLamportTime.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /** Advances the clock past the timestamp of an incoming packet. @return the new time of the process */
+    LamportTime mergeLamportTime(LamportTime receivedTime) {
+        LamportTime current = currentLamportTime.load(std::memory_order_relaxed);
+        LamportTime merged;
+        do {
+            merged = std::max(receivedTime, current) + 1;
+        } while (not currentLamportTime.compare_exchange_weak(current, merged, std::memory_order_relaxed));
+        return merged;
+    }
+
     ProcessId myProcessId;
 
     ProcessId numberOfProcesses;
 
     std::unordered_set<ProcessId> otherProcesses;
 
-    LamportTime currentLamportTime;
+    /** Lock-free, so that logging (which reads it all the time) never waits for the sending or receiving threads */
+    std::atomic<LamportTime> currentLamportTime {0};
 };
 
 #endif //INC_3PC_ICOMMUNICATOR_H
@@ -21,6 +21,27 @@ public:
         return send(messageType, message, otherProcesses, tag);
     };
 
+    using ICommunicator::send;
+
+    using ICommunicator::sendOthers;
+
+    virtual LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                             std::size_t numberOfRecipients, Tag tag) {
+        return send(messageType, std::string(message),
+                    std::unordered_set<ProcessId>(recipients, recipients + numberOfRecipients), tag).lamportTime;
+    }
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients) override {
+        return post(messageType, message, recipients, numberOfRecipients, getDefaultTag());
+    }
+
+    LamportTime post(MessageType messageType, std::string_view message, ProcessId recipient, Tag tag) {
+        return post(messageType, message, &recipient, 1, tag);
+    }
+
+    using ICommunicator::post;
+
     virtual Packet receive(Tag tag) = 0;
 
     virtual std::optional<Packet> receive(long timeoutMillis, Tag tag) = 0;
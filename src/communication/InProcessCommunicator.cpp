@@ -0,0 +1,94 @@
+#include "InProcessCommunicator.h"
+
+InProcessNetwork::InProcessNetwork(ProcessId numberOfProcesses) {
+    mailboxes.reserve(static_cast<unsigned long>(numberOfProcesses));
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        mailboxes.push_back(std::make_unique<Mailbox<Packet>>());
+    }
+}
+
+ProcessId InProcessNetwork::size() const {
+    return static_cast<ProcessId>(mailboxes.size());
+}
+
+Mailbox<Packet>& InProcessNetwork::mailboxOf(ProcessId process) {
+    return *mailboxes.at(static_cast<unsigned long>(process));
+}
+
+InProcessCommunicator::InProcessCommunicator(std::shared_ptr<InProcessNetwork> network, ProcessId processId)
+        : network(std::move(network)) {
+    myProcessId = processId;
+    numberOfProcesses = this->network->size();
+    // 'otherProcesses' is intentionally left empty - with thousands of simulated processes it would take O(N^2) memory
+}
+
+Packet InProcessCommunicator::send(MessageType messageType, const std::string& message,
+                                   const std::unordered_set<ProcessId>& recipients) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    Packet packet = stamp(messageType, message);
+    for (ProcessId recipient : recipients) {
+        network->mailboxOf(recipient).push(packet);
+    }
+    return packet;
+}
+
+Packet InProcessCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    Packet packet = stamp(messageType, message);
+    network->mailboxOf(recipient).push(packet);
+    return packet;
+}
+
+Packet InProcessCommunicator::sendOthers(MessageType messageType, const std::string& message) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    Packet packet = stamp(messageType, message);
+    for (ProcessId recipient = 0; recipient < numberOfProcesses; ++recipient) {
+        if (recipient != myProcessId) {
+            network->mailboxOf(recipient).push(packet);
+        }
+    }
+    return packet;
+}
+
+LamportTime InProcessCommunicator::post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                        std::size_t numberOfRecipients) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    Packet packet = stamp(messageType, message);
+    const LamportTime lamportTime = packet.lamportTime;
+    for (std::size_t i = 0; i + 1 < numberOfRecipients; ++i) {
+        network->mailboxOf(recipients[i]).push(packet);
+    }
+    if (numberOfRecipients > 0) {
+        // The last recipient can take over the packet instead of a copy of it
+        network->mailboxOf(recipients[numberOfRecipients - 1]).push(std::move(packet));
+    }
+    return lamportTime;
+}
+
+Packet InProcessCommunicator::receive() {
+    Packet packet = network->mailboxOf(myProcessId).pop();
+    updateTimestamp(packet);
+    return packet;
+}
+
+std::optional<Packet> InProcessCommunicator::receive(long timeoutMillis) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    std::optional<Packet> packet = network->mailboxOf(myProcessId).pop(deadline);
+    if (packet) {
+        updateTimestamp(*packet);
+    }
+    return packet;
+}
+
+Packet InProcessCommunicator::stamp(MessageType messageType, std::string_view message) {
+    return Packet {
+            .lamportTime = tickLamportTime(),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = std::string(message)
+    };
+}
+
+void InProcessCommunicator::updateTimestamp(Packet& packet) {
+    packet.lamportTime = mergeLamportTime(packet.lamportTime);
+}
@@ -0,0 +1,62 @@
+#ifndef INC_3PC_INPROCESSCOMMUNICATOR_H
+#define INC_3PC_INPROCESSCOMMUNICATOR_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <util/Mailbox.h>
+#include "ICommunicator.h"
+
+/**
+ * Set of mailboxes shared by all logical processes simulated inside a single binary.
+ */
+class InProcessNetwork {
+public:
+
+    explicit InProcessNetwork(ProcessId numberOfProcesses);
+
+    ProcessId size() const;
+
+    Mailbox<Packet>& mailboxOf(ProcessId process);
+
+private:
+
+    std::vector<std::unique_ptr<Mailbox<Packet>>> mailboxes;
+};
+
+/**
+ * Runs a logical process as a set of threads in the same address space as all the other ones. Packets are handed over
+ * through lock-free mailboxes instead of MPI, which allows to simulate rings far bigger than mpirun would allow.
+ */
+class InProcessCommunicator : public ICommunicator {
+public:
+
+    InProcessCommunicator(std::shared_ptr<InProcessNetwork> network, ProcessId processId);
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients) override;
+
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient) override;
+
+    Packet sendOthers(MessageType messageType, const std::string& message) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients) override;
+
+    using ICommunicator::post;
+
+    Packet receive() override;
+
+    std::optional<Packet> receive(long timeoutMillis) override;
+
+protected:
+
+    /** Has to be called with 'sendMutex' held, so that packets enter the mailboxes in timestamp order */
+    Packet stamp(MessageType messageType, std::string_view message);
+
+    void updateTimestamp(Packet& packet);
+
+    std::shared_ptr<InProcessNetwork> network;
+    std::mutex sendMutex;
+};
+
+#endif //INC_3PC_INPROCESSCOMMUNICATOR_H
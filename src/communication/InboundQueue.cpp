@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "InboundQueue.h"
+
+InboundQueue::InboundQueue(InboundQueueOptions options) : options(options) { }
+
+void InboundQueue::push(Packet packet) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    InboundStatistics& typeStatistics = statisticsOf(packet.messageType);
+    QueuedPacket queued {.packet = std::move(packet), .enqueueTime = std::chrono::steady_clock::now()};
+
+    if (packets.size() >= options.capacity) {
+        switch (options.overflowPolicy) {
+            case OverflowPolicy::BLOCK:
+                notFullCond.wait(lock, [&]() { return packets.size() < options.capacity or closed; });
+                break;
+            case OverflowPolicy::DROP_OLDEST: {
+                ++typeStatistics.dropped;
+                auto oldest = std::find_if(packets.begin(), packets.end(), [&](const QueuedPacket& candidate) {
+                    return candidate.packet.messageType == queued.packet.messageType;
+                });
+                if (oldest == packets.end()) {
+                    return;
+                }
+                packets.erase(oldest);
+                --typeStatistics.depth;
+                break;
+            }
+            case OverflowPolicy::SPILL:
+                break;
+        }
+    }
+    if (closed) {
+        return;
+    }
+    ++typeStatistics.enqueued;
+    typeStatistics.maxDepth = std::max(typeStatistics.maxDepth, ++typeStatistics.depth);
+    // Once anything has spilled, newer packets have to queue up behind it to keep the order
+    if (packets.size() >= options.capacity or not spilledPackets.empty()) {
+        ++typeStatistics.spilled;
+        spilledPackets.push_back(std::move(queued));
+        return;
+    }
+    packets.push_back(std::move(queued));
+    notEmptyCond.notify_one();
+}
+
+std::optional<Packet> InboundQueue::pop(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (not notEmptyCond.wait_until(lock, deadline, [&]() { return not packets.empty() or closed; }) or closed) {
+        return std::nullopt;
+    }
+    QueuedPacket queued = std::move(packets.front());
+    packets.pop_front();
+    if (not spilledPackets.empty()) {
+        packets.push_back(std::move(spilledPackets.front()));
+        spilledPackets.pop_front();
+    }
+    notFullCond.notify_one();
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - queued.enqueueTime);
+    InboundStatistics& typeStatistics = statisticsOf(queued.packet.messageType);
+    --typeStatistics.depth;
+    ++typeStatistics.dispatched;
+    typeStatistics.totalLatency += latency;
+    typeStatistics.maxLatency = std::max(typeStatistics.maxLatency, latency);
+    return std::move(queued.packet);
+}
+
+void InboundQueue::close() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    closed = true;
+    notEmptyCond.notify_all();
+    notFullCond.notify_all();
+}
+
+InboundStatistics InboundQueue::getStatistics(MessageType messageType) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return statisticsOf(messageType);
+}
+
+InboundStatistics& InboundQueue::statisticsOf(MessageType messageType) {
+    return statistics[static_cast<std::size_t>(messageType)];
+}
@@ -0,0 +1,84 @@
+#ifndef INC_3PC_INBOUNDQUEUE_H
+#define INC_3PC_INBOUNDQUEUE_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include "ICommunicator.h"
+
+#define INBOUND_QUEUE_DEFAULT_CAPACITY 1024
+
+/** What happens to a packet which arrives while the queue is full */
+enum class OverflowPolicy : unsigned char {
+    /** The receiving thread waits for the handlers to make room, so the network backs up instead */
+    BLOCK,
+    /** The oldest queued packet of the same type makes room, or the arriving one is dropped if there is none */
+    DROP_OLDEST,
+    /** The packet goes to an unbounded overflow list, which refills the queue in order as it drains */
+    SPILL
+};
+
+struct InboundQueueOptions {
+    std::size_t capacity = INBOUND_QUEUE_DEFAULT_CAPACITY;
+    OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+};
+
+/** Kept separately for every message type */
+struct InboundStatistics {
+    /** Packets currently waiting, including the spilled ones */
+    unsigned long depth = 0;
+    unsigned long maxDepth = 0;
+    unsigned long enqueued = 0;
+    unsigned long dispatched = 0;
+    unsigned long dropped = 0;
+    unsigned long spilled = 0;
+    /** Time between enqueuing a packet and taking it out for dispatch */
+    std::chrono::microseconds totalLatency {0};
+    std::chrono::microseconds maxLatency {0};
+};
+
+/**
+ * Bounded queue between the thread receiving packets from the communicator and the thread dispatching them to the
+ * subscriptions, so that bursts are absorbed and slow handlers show up as queueing in the statistics.
+ */
+class InboundQueue {
+public:
+
+    explicit InboundQueue(InboundQueueOptions options);
+
+    void push(Packet packet);
+
+    /** @return nullopt if nothing has arrived before the deadline or the queue has been closed */
+    std::optional<Packet> pop(std::chrono::steady_clock::time_point deadline);
+
+    /** Wakes up both sides for good, packets still waiting are discarded */
+    void close();
+
+    InboundStatistics getStatistics(MessageType messageType);
+
+protected:
+
+    struct QueuedPacket {
+        Packet packet;
+        std::chrono::steady_clock::time_point enqueueTime;
+    };
+
+    /** Has to be called with 'queueMutex' held */
+    InboundStatistics& statisticsOf(MessageType messageType);
+
+    InboundQueueOptions options;
+    std::deque<QueuedPacket> packets;
+    /** Only ever used by OverflowPolicy::SPILL */
+    std::deque<QueuedPacket> spilledPackets;
+    std::array<InboundStatistics, NUMBER_OF_MESSAGE_TYPES> statistics;
+    bool closed = false;
+
+    std::mutex queueMutex;
+    std::condition_variable notEmptyCond;
+    std::condition_variable notFullCond;
+};
+
+#endif //INC_3PC_INBOUNDQUEUE_H
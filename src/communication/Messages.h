@@ -0,0 +1,140 @@
+#ifndef INC_3PC_MESSAGES_H
+#define INC_3PC_MESSAGES_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <util/StringConcat.h>
+#include "ICommunicator.h"
+
+/**
+ * Binary payloads of the typed messages. Every message type declares its payload struct in MessageSchema, the struct
+ * travels as its raw bytes, so it has to be trivially copyable (all the processes run the same binary on the same
+ * architecture). Message types without a schema (e.g. BATCH) carry arbitrary bytes.
+ */
+struct TokenMessage {
+    int32_t value;
+};
+
+struct CrashMessage {
+    /** Token to omit - either PING or PONG */
+    MessageType token;
+};
+
+template <MessageType type>
+struct MessageSchema;
+
+template <>
+struct MessageSchema<MessageType::PING> {
+    using Payload = TokenMessage;
+};
+
+template <>
+struct MessageSchema<MessageType::PONG> {
+    using Payload = TokenMessage;
+};
+
+template <>
+struct MessageSchema<MessageType::CRASH> {
+    using Payload = CrashMessage;
+};
+
+template <MessageType type>
+using MessagePayload = typename MessageSchema<type>::Payload;
+
+template <typename Payload>
+inline std::string_view encodeMessage(const Payload& payload) {
+    static_assert(std::is_trivially_copyable_v<Payload>, "Message payloads must be trivially copyable");
+    return {reinterpret_cast<const char*>(&payload), sizeof(payload)};
+}
+
+template <MessageType type>
+inline MessagePayload<type> decodeMessage(const Packet& packet) {
+    MessagePayload<type> payload;
+    if (packet.messageType != type or packet.message.size() != sizeof(payload)) {
+        throw std::runtime_error(util::concat("Malformed ", packet.messageType, " packet of ", packet.message.size(),
+                                              " bytes from process ", packet.source));
+    }
+    std::memcpy(&payload, packet.message.data(), sizeof(payload));
+    return payload;
+}
+
+/**
+ * REQUEST and REPLY messages wrap another message behind a header of
+ * [CorrelationId correlationId][MessageType messageType], which ties the reply to its request.
+ */
+constexpr std::size_t CORRELATION_HEADER_SIZE = sizeof(CorrelationId) + sizeof(MessageType);
+
+inline std::string wrapCorrelated(CorrelationId correlationId, MessageType messageType, std::string_view message) {
+    std::string wrapped(CORRELATION_HEADER_SIZE + message.size(), '\0');
+    std::memcpy(wrapped.data(), &correlationId, sizeof(correlationId));
+    std::memcpy(wrapped.data() + sizeof(correlationId), &messageType, sizeof(messageType));
+    message.copy(wrapped.data() + CORRELATION_HEADER_SIZE, message.size());
+    return wrapped;
+}
+
+/** @return the wrapped message as if it has been received on its own, with the correlation id set */
+inline Packet unwrapCorrelated(const Packet& packet) {
+    if (packet.message.size() < CORRELATION_HEADER_SIZE) {
+        throw std::runtime_error(util::concat("Malformed ", packet.messageType, " packet of ", packet.message.size(),
+                                              " bytes from process ", packet.source));
+    }
+    const std::string_view message = packet.message;
+    Packet unwrapped {.lamportTime = packet.lamportTime, .source = packet.source, .messageType = {},
+                      .message = message.substr(CORRELATION_HEADER_SIZE)};
+    std::memcpy(&unwrapped.correlationId, message.data(), sizeof(unwrapped.correlationId));
+    std::memcpy(&unwrapped.messageType, message.data() + sizeof(unwrapped.correlationId), sizeof(MessageType));
+    // Indexes the subscription table later on, and an envelope inside an envelope is never sent
+    if (static_cast<std::size_t>(unwrapped.messageType) >= NUMBER_OF_MESSAGE_TYPES or
+        unwrapped.messageType == MessageType::REQUEST or unwrapped.messageType == MessageType::REPLY or
+        unwrapped.messageType == MessageType::BATCH) {
+        throw std::runtime_error(util::concat("Malformed ", packet.messageType, " packet wrapping message type ",
+                                              static_cast<int>(unwrapped.messageType), " from process ",
+                                              packet.source));
+    }
+    return unwrapped;
+}
+
+/** Human-readable form of the message for logging */
+inline std::string describeMessage(MessageType messageType, std::string_view message) {
+    switch (messageType) {
+        case MessageType::PING:
+        case MessageType::PONG: {
+            TokenMessage token;
+            if (message.size() == sizeof(token)) {
+                std::memcpy(&token, message.data(), sizeof(token));
+                return std::to_string(token.value);
+            }
+            break;
+        }
+        case MessageType::CRASH: {
+            CrashMessage crash;
+            if (message.size() == sizeof(crash)) {
+                std::memcpy(&crash, message.data(), sizeof(crash));
+                return util::concat(crash.token);
+            }
+            break;
+        }
+        case MessageType::REQUEST:
+        case MessageType::REPLY: {
+            if (message.size() >= CORRELATION_HEADER_SIZE) {
+                CorrelationId correlationId;
+                MessageType wrappedType;
+                std::memcpy(&correlationId, message.data(), sizeof(correlationId));
+                std::memcpy(&wrappedType, message.data() + sizeof(correlationId), sizeof(wrappedType));
+                if (static_cast<std::size_t>(wrappedType) >= NUMBER_OF_MESSAGE_TYPES) {
+                    break;
+                }
+                return util::concat('#', correlationId, ' ', wrappedType, ' ',
+                                    describeMessage(wrappedType, message.substr(CORRELATION_HEADER_SIZE)));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return util::concat(message.size(), " bytes");
+}
+
+#endif //INC_3PC_MESSAGES_H
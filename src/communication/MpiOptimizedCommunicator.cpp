@@ -1,96 +1,288 @@
 #include "MpiOptimizedCommunicator.h"
+#include <cstring>
+#include <limits>
+
+namespace {
+    /** Every sending thread encodes into its own buffer, which only ever grows, so steady-state sends do not allocate */
+    thread_local std::string sendBuffer;
+    thread_local std::vector<MPI_Request> sendRequests;
+}
 
 Packet MpiOptimizedCommunicator::send(MessageType messageType, const std::string& message,
                                       const std::unordered_set<ProcessId>& recipients, MpiTag tag) {
 
-    std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-    std::string finalMessage = encode(++currentLamportTime, messageType, message);
+    return Packet {
+            .lamportTime = transmit(messageType, message, recipients.begin(), recipients.end(), tag),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+Packet MpiOptimizedCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient,
+                                      MpiTag tag) {
+
+    return Packet {
+            .lamportTime = transmit(messageType, message, &recipient, &recipient + 1, tag),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+LamportTime MpiOptimizedCommunicator::post(MessageType messageType, std::string_view message,
+                                           const ProcessId* recipients, std::size_t numberOfRecipients, MpiTag tag) {
 
-    for (ProcessId recipient : recipients) {
-        MPI_Send(finalMessage.c_str(), static_cast<int>(finalMessage.size()), MPI_BYTE, recipient, tag, MPI_COMM_WORLD);
+    return transmit(messageType, message, recipients, recipients + numberOfRecipients, tag);
+}
+
+Packet MpiOptimizedCommunicator::sendOthers(MessageType messageType, const std::string& message, MpiTag tag) {
+    if (tag != MPI_DEFAULT_TAG or numberOfProcesses - 1 < MPI_TREE_BROADCAST_THRESHOLD) {
+        return MpiSimpleCommunicator::sendOthers(messageType, message, tag);
     }
+    LamportTime lamportTime;
+    std::size_t frameSize;
+    {
+        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
+        lamportTime = tickLamportTime();
+        frameSize = sizeof(EncodedProcessId) + getFrameSize(message);
+        checkFrameSize(frameSize);
+        if (sendBuffer.size() < frameSize) {
+            sendBuffer.resize(frameSize);
+        }
+        const auto root = static_cast<EncodedProcessId>(myProcessId);
+        std::memcpy(sendBuffer.data(), &root, sizeof(root));
+        encode(sendBuffer.data() + sizeof(root), lamportTime, messageType, message);
+    }
+    relayBroadcast(sendBuffer.data(), frameSize, myProcessId);
 
     return Packet {
-            .lamportTime = currentLamportTime,
+            .lamportTime = lamportTime,
             .source = myProcessId,
             .messageType = messageType,
             .message = message
     };
 }
 
+Packet MpiOptimizedCommunicator::sendOthers(MessageType messageType, const std::string& message) {
+    return sendOthers(messageType, message, getDefaultTag());
+}
+
+template <typename Iterator>
+LamportTime MpiOptimizedCommunicator::transmit(MessageType messageType, std::string_view message,
+                                               Iterator firstRecipient, Iterator lastRecipient, MpiTag tag) {
+    LamportTime lamportTime;
+    sendRequests.clear();
+    {
+        // The lock is only held for stamping and posting the sends, which keeps the per-link order of the packets
+        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
+        lamportTime = tickLamportTime();
+        const auto frameSize = encode(sendBuffer, lamportTime, messageType, message);
+        checkFrameSize(frameSize);
+
+        for (Iterator recipient = firstRecipient; recipient != lastRecipient; ++recipient) {
+            MPI_Isend(sendBuffer.data(), static_cast<int>(frameSize), MPI_BYTE, toRank(*recipient), tag, mpiCommunicator,
+                      &sendRequests.emplace_back());
+        }
+    }
+    MPI_Waitall(static_cast<int>(sendRequests.size()), sendRequests.data(), MPI_STATUSES_IGNORE);
+    return lamportTime;
+}
+
+void MpiOptimizedCommunicator::relayBroadcast(const char* frame, std::size_t frameSize, ProcessId root) {
+    // Binomial tree over the ranks renumbered so that the root becomes 0 - every process forwards the frame to the
+    // subtrees below the lowest set bit of its relative rank, so the broadcast takes O(log N) rounds
+    const ProcessId relativeRank = (myProcessId - root + numberOfProcesses) % numberOfProcesses;
+    ProcessId mask = 1;
+    while (mask < numberOfProcesses and not (relativeRank & mask)) {
+        mask <<= 1;
+    }
+    sendRequests.clear();
+    {
+        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
+        for (mask >>= 1; mask > 0; mask >>= 1) {
+            if (relativeRank + mask < numberOfProcesses) {
+                ProcessId child = (relativeRank + mask + root) % numberOfProcesses;
+                MPI_Isend(frame, static_cast<int>(frameSize), MPI_BYTE, toRank(child), MPI_BROADCAST_TAG, mpiCommunicator,
+                          &sendRequests.emplace_back());
+            }
+        }
+    }
+    MPI_Waitall(static_cast<int>(sendRequests.size()), sendRequests.data(), MPI_STATUSES_IGNORE);
+}
+
+void MpiOptimizedCommunicator::decodeReceived(const char* frame, std::size_t frameSize, const MPI_Status& status,
+                                              Packet& packet) {
+    if (status.MPI_TAG != MPI_BROADCAST_TAG) {
+        decode(frame, frameSize, toProcessId(status.MPI_SOURCE), packet);
+        return;
+    }
+    EncodedProcessId root;
+    std::memcpy(&root, frame, sizeof(root));
+    relayBroadcast(frame, frameSize, root);
+    decode(frame + sizeof(root), frameSize - sizeof(root), root, packet);
+}
+
+std::size_t MpiOptimizedCommunicator::getMaxFrameSize() const {
+    return isPreposted() ? MPI_MAX_FRAME_SIZE : std::numeric_limits<int>::max();
+}
+
+void MpiOptimizedCommunicator::checkFrameSize(std::size_t frameSize) const {
+    if (frameSize > getMaxFrameSize()) {
+        throw std::length_error("Frame of " + std::to_string(frameSize) + " bytes exceeds the limit of " +
+                                std::to_string(getMaxFrameSize()) + " bytes");
+    }
+}
+
 Packet MpiOptimizedCommunicator::receive(MpiTag tag) {
     MPI_Status status;
+    if (isPreposted() and tag == MPI_ANY_TAG) {
+        Packet packet;
+        MPI_Wait(&prepostedRequests[nextPrepostedSlot], &status);
+        consumePreposted(status, packet);
+        return packet;
+    }
     int messageLength;
 
-    MPI_Probe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &status);
+    MPI_Probe(MPI_ANY_SOURCE, tag, mpiCommunicator, &status);
     MPI_Get_count(&status, MPI_BYTE, &messageLength);
 
-    ProcessId source = status.MPI_SOURCE;
     std::string message;
     message.resize(static_cast<unsigned long>(messageLength));
-    MPI_Recv(message.data(), messageLength, MPI_BYTE, source, tag, MPI_COMM_WORLD, &status);
+    MPI_Recv(message.data(), messageLength, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, mpiCommunicator, &status);
 
-    Packet packet = getPacket(message, source);
+    Packet packet;
+    decodeReceived(message.data(), message.size(), status, packet);
     updateTimestamp(packet);
     return packet;
 }
 
 std::optional<Packet> MpiOptimizedCommunicator::receive(long timeoutMillis, MpiTag tag) {
-    using namespace std::chrono;
     MPI_Status status;
     int hasReceivedData;
-    auto timeStarted = system_clock::now();
 
-    do {
-        MPI_Iprobe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &hasReceivedData, &status);
-    } while (not hasReceivedData &&
-             duration_cast<milliseconds>(system_clock::now() - timeStarted).count() < timeoutMillis);
-    if (not hasReceivedData) {
+    if (isPreposted() and tag == MPI_ANY_TAG) {
+        if (not waitStrategy.waitFor(timeoutMillis, [&]() {
+            MPI_Test(&prepostedRequests[nextPrepostedSlot], &hasReceivedData, &status);
+            return hasReceivedData;
+        })) {
+            return std::nullopt;
+        }
+        Packet packet;
+        consumePreposted(status, packet);
+        return packet;
+    }
+
+    if (not waitStrategy.waitFor(timeoutMillis, [&]() {
+        MPI_Iprobe(MPI_ANY_SOURCE, tag, mpiCommunicator, &hasReceivedData, &status);
+        return hasReceivedData;
+    })) {
         return std::nullopt;
     }
 
-    ProcessId source = status.MPI_SOURCE;
     int messageLength;
     MPI_Get_count(&status, MPI_BYTE, &messageLength);
     std::string message;
     message.resize(static_cast<unsigned long>(messageLength));
-    MPI_Recv(message.data(), messageLength, MPI_BYTE, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(message.data(), messageLength, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, mpiCommunicator,
+             MPI_STATUS_IGNORE);
 
-    Packet packet = getPacket(message, source);
+    Packet packet;
+    decodeReceived(message.data(), message.size(), status, packet);
     updateTimestamp(packet);
     return packet;
 }
 
-std::string MpiOptimizedCommunicator::encode(LamportTime lamportTime, MessageType messageType, const std::string& message) {
-    std::string finalMessage;
+void MpiOptimizedCommunicator::receive(const PacketConsumer& consumer) {
+    if (not isPreposted()) {
+        consumer(receive());
+        return;
+    }
+    MPI_Status status;
+    MPI_Wait(&prepostedRequests[nextPrepostedSlot], &status);
+    consumePreposted(status, receivedPacket);
+    consumer(receivedPacket);
+}
+
+void MpiOptimizedCommunicator::consumePreposted(const MPI_Status& status, Packet& packet) {
+    int frameSize;
+    MPI_Get_count(&status, MPI_BYTE, &frameSize);
+    const std::size_t slot = nextPrepostedSlot;
+    decodeReceived(prepostedBuffers.data() + slot * MPI_MAX_FRAME_SIZE, static_cast<std::size_t>(frameSize), status,
+                   packet);
+    // The frame has already been copied out, so the slot can go back to MPI before the packet is even processed
+    postReceive(slot);
+    nextPrepostedSlot = (slot + 1) % prepostedRequests.size();
+    updateTimestamp(packet);
+}
+
+void MpiOptimizedCommunicator::postReceive(std::size_t slot) {
+    MPI_Irecv(prepostedBuffers.data() + slot * MPI_MAX_FRAME_SIZE, MPI_MAX_FRAME_SIZE, MPI_BYTE, MPI_ANY_SOURCE,
+              MPI_ANY_TAG, mpiCommunicator, &prepostedRequests[slot]);
+}
+
+bool MpiOptimizedCommunicator::isPreposted() const {
+    return not prepostedRequests.empty();
+}
+
+std::size_t MpiOptimizedCommunicator::encode(std::string& buffer, LamportTime lamportTime, MessageType messageType,
+                                             std::string_view message) {
+    const auto frameSize = getFrameSize(message);
+    if (buffer.size() < frameSize) {
+        buffer.resize(frameSize);
+    }
+    return encode(buffer.data(), lamportTime, messageType, message);
+}
+
+std::size_t MpiOptimizedCommunicator::encode(char* frame, LamportTime lamportTime, MessageType messageType,
+                                             std::string_view message) {
     const auto encodedLamportTime = static_cast<EncodedLamportTime>(lamportTime);
     const auto encodedMessageType = static_cast<EncodedMessageType>(messageType);
-    finalMessage.resize(sizeof(encodedLamportTime) + sizeof(encodedMessageType) + message.size());
-    *(reinterpret_cast<EncodedLamportTime*>(finalMessage.data())) = encodedLamportTime;
-    *(reinterpret_cast<EncodedMessageType*>(finalMessage.data() + sizeof(encodedLamportTime))) = encodedMessageType;
-    message.copy(finalMessage.data() + sizeof(encodedLamportTime) + sizeof(encodedMessageType), message.size());
-    return finalMessage;
+    std::memcpy(frame, &encodedLamportTime, sizeof(encodedLamportTime));
+    std::memcpy(frame + sizeof(encodedLamportTime), &encodedMessageType, sizeof(encodedMessageType));
+    message.copy(frame + sizeof(encodedLamportTime) + sizeof(encodedMessageType), message.size());
+    return getFrameSize(message);
+}
+
+std::size_t MpiOptimizedCommunicator::getFrameSize(std::string_view message) {
+    return sizeof(EncodedLamportTime) + sizeof(EncodedMessageType) + message.size();
 }
 
 Packet MpiOptimizedCommunicator::getPacket(const std::string& encodedMessage, ProcessId source) {
-    const auto lamportTime = static_cast<LamportTime>(*reinterpret_cast<const EncodedLamportTime*>(encodedMessage.data()));
-    const auto messageType = static_cast<MessageType>(*reinterpret_cast<const EncodedMessageType*>(encodedMessage.data() + sizeof(EncodedLamportTime)));
-    const auto headerSize = sizeof(EncodedLamportTime) + sizeof(EncodedMessageType);
+    Packet packet;
+    decode(encodedMessage.data(), encodedMessage.size(), source, packet);
+    return packet;
+}
 
-    return Packet {
-            .lamportTime = lamportTime,
-            .source = source,
-            .messageType = messageType,
-            .message = encodedMessage.substr(headerSize)
-    };
+void MpiOptimizedCommunicator::decode(const char* frame, std::size_t frameSize, ProcessId source, Packet& packet) {
+    EncodedLamportTime encodedLamportTime;
+    EncodedMessageType encodedMessageType;
+    const auto headerSize = sizeof(encodedLamportTime) + sizeof(encodedMessageType);
+    std::memcpy(&encodedLamportTime, frame, sizeof(encodedLamportTime));
+    std::memcpy(&encodedMessageType, frame + sizeof(encodedLamportTime), sizeof(encodedMessageType));
+
+    packet.lamportTime = static_cast<LamportTime>(encodedLamportTime);
+    packet.source = source;
+    packet.messageType = static_cast<MessageType>(encodedMessageType);
+    packet.message.assign(frame + headerSize, frameSize - headerSize);
 }
 
 void MpiOptimizedCommunicator::updateTimestamp(Packet& packet) {
-    {
-        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-        currentLamportTime = std::max(packet.lamportTime, currentLamportTime) + 1;
+    packet.lamportTime = mergeLamportTime(packet.lamportTime);
+}
+
+MpiOptimizedCommunicator::MpiOptimizedCommunicator(int argc, char** argv, unsigned prepostedReceives)
+        : MpiSimpleCommunicator(argc, argv), prepostedRequests(prepostedReceives, MPI_REQUEST_NULL),
+          prepostedBuffers(prepostedReceives * MPI_MAX_FRAME_SIZE) {
+
+    for (std::size_t slot = 0; slot < prepostedRequests.size(); ++slot) {
+        postReceive(slot);
     }
-    packet.lamportTime = currentLamportTime;
 }
 
-MpiOptimizedCommunicator::MpiOptimizedCommunicator(int argc, char** argv) : MpiSimpleCommunicator(argc, argv) { }
+MpiOptimizedCommunicator::~MpiOptimizedCommunicator() {
+    for (MPI_Request& request : prepostedRequests) {
+        MPI_Cancel(&request);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+}
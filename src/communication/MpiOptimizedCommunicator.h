@@ -1,26 +1,105 @@
 #ifndef INC_3PC_MPIOPTIMIZEDCOMMUNICATOR_H
 #define INC_3PC_MPIOPTIMIZEDCOMMUNICATOR_H
 
+#include <vector>
 #include "MpiSimpleCommunicator.h"
 
+/** Upper bound for a single encoded frame when receives are preposted */
+#define MPI_MAX_FRAME_SIZE 256
+#define MPI_BROADCAST_TAG 2
+/** Minimal number of recipients for which sendOthers() relays the packet along a binomial tree */
+#define MPI_TREE_BROADCAST_THRESHOLD 8
+
 class MpiOptimizedCommunicator : public MpiSimpleCommunicator {
 public:
 
-    MpiOptimizedCommunicator(int argc, char** argv);
+    /**
+     * @param prepostedReceives if non-zero, a ring of that many MPI_Irecv requests of MPI_MAX_FRAME_SIZE bytes is kept
+     * posted, which saves the MPI_Probe + MPI_Get_count round and the allocations of every untagged receive. In this mode
+     * the ring matches messages of all tags, so receiving with a specific tag should not be mixed with it.
+     */
+    MpiOptimizedCommunicator(int argc, char** argv, unsigned prepostedReceives = 0);
+
+    ~MpiOptimizedCommunicator() override;
 
     Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, MpiTag tag) override;
 
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient, MpiTag tag) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients, MpiTag tag) override;
+
+    /**
+     * Big enough broadcasts are relayed along a binomial tree, so they take O(log N) instead of O(N) sequential sends.
+     * Relayed frames are prefixed with the root process id and travel with MPI_BROADCAST_TAG.
+     * Such a broadcast gives up the FIFO order with the other packets of the root: a relayed frame reaches most of the
+     * processes through an intermediate one, so it may arrive before a packet the root has sent to them directly
+     * earlier, or after one sent later. Only relayed broadcasts of the same root keep their order. Senders which need
+     * the order have to wait for an acknowledgement or stay below MPI_TREE_BROADCAST_THRESHOLD recipients.
+     */
+    Packet sendOthers(MessageType messageType, const std::string& message, MpiTag tag) override;
+
+    Packet sendOthers(MessageType messageType, const std::string& message) override;
+
+    using MpiSimpleCommunicator::send;
+
+    using MpiSimpleCommunicator::post;
+
     Packet receive(MpiTag tag) override;
 
     std::optional<Packet> receive(long timeoutMillis, MpiTag tag) override;
 
-protected:
+    void receive(const PacketConsumer& consumer) override;
+
+    using MpiSimpleCommunicator::receive;
+
+    /**
+     * Encodes the packet into the given buffer, reusing its capacity.
+     * @return size of the encoded frame
+     */
+    static std::size_t encode(std::string& buffer, LamportTime lamportTime, MessageType messageType, std::string_view message);
+
+    /** Encodes the packet into a raw buffer, which has to be at least getFrameSize() bytes long */
+    static std::size_t encode(char* frame, LamportTime lamportTime, MessageType messageType, std::string_view message);
 
-    static std::string encode(LamportTime lamportTime, MessageType messageType, const std::string& message);
+    static std::size_t getFrameSize(std::string_view message);
 
     static Packet getPacket(const std::string& encodedMessage, ProcessId source);
 
+    /** Decodes the frame into an existing packet, reusing the capacity of its message */
+    static void decode(const char* frame, std::size_t frameSize, ProcessId source, Packet& packet);
+
+protected:
+
+    template <typename Iterator>
+    LamportTime transmit(MessageType messageType, std::string_view message, Iterator firstRecipient,
+                         Iterator lastRecipient, MpiTag tag);
+
+    /** Forwards a broadcast frame to the children of this process in the tree rooted at 'root' */
+    void relayBroadcast(const char* frame, std::size_t frameSize, ProcessId root);
+
+    /** Decodes a received frame, relaying it first if it is a part of a broadcast */
+    void decodeReceived(const char* frame, std::size_t frameSize, const MPI_Status& status, Packet& packet);
+
+    /** Largest frame the receiving side is able to accept */
+    virtual std::size_t getMaxFrameSize() const;
+
+    void checkFrameSize(std::size_t frameSize) const;
+
     void updateTimestamp(Packet& packet);
+
+    bool isPreposted() const;
+
+    void postReceive(std::size_t slot);
+
+    /** Decodes the oldest preposted slot into the packet and posts the slot again */
+    void consumePreposted(const MPI_Status& status, Packet& packet);
+
+    /** Preposted slots are completed strictly in the order they were posted, which is the order MPI matches them in */
+    std::vector<MPI_Request> prepostedRequests;
+    std::vector<char> prepostedBuffers;
+    std::size_t nextPrepostedSlot = 0;
+    Packet receivedPacket {};
 };
 
 
@@ -0,0 +1,183 @@
+#include "MpiProgressCommunicator.h"
+#include <iostream>
+#include "MpiOptimizedCommunicator.h"
+
+MpiProgressCommunicator::MpiProgressCommunicator(int argc, char** argv, WaitStrategy waitStrategy)
+        : waitStrategy(waitStrategy) {
+    // MPI has to be initialized by the thread which is going to make all the calls in the funneled mode
+    std::promise<void> initialized;
+    progressThread = std::thread([this, argc, argv, &initialized]() {
+        progressThreadFunction(argc, argv, initialized);
+    });
+    initialized.get_future().wait();
+}
+
+MpiProgressCommunicator::~MpiProgressCommunicator() {
+    terminate.store(true, std::memory_order_release);
+    progressThread.join();
+}
+
+Packet MpiProgressCommunicator::send(MessageType messageType, const std::string& message,
+                                     const std::unordered_set<ProcessId>& recipients) {
+    return Packet {
+            .lamportTime = enqueue(messageType, message, recipients.begin(), recipients.end()),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+Packet MpiProgressCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient) {
+    return Packet {
+            .lamportTime = post(messageType, message, &recipient, 1),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+Packet MpiProgressCommunicator::sendOthers(MessageType messageType, const std::string& message) {
+    return send(messageType, message, otherProcesses);
+}
+
+LamportTime MpiProgressCommunicator::post(MessageType messageType, std::string_view message,
+                                          const ProcessId* recipients, std::size_t numberOfRecipients) {
+    return enqueue(messageType, message, recipients, recipients + numberOfRecipients);
+}
+
+Packet MpiProgressCommunicator::receive() {
+    Packet packet = inbox.pop();
+    packet.lamportTime = mergeLamportTime(packet.lamportTime);
+    return packet;
+}
+
+std::optional<Packet> MpiProgressCommunicator::receive(long timeoutMillis) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    std::optional<Packet> packet = inbox.pop(deadline);
+    if (packet) {
+        packet->lamportTime = mergeLamportTime(packet->lamportTime);
+    }
+    return packet;
+}
+
+template <typename Iterator>
+LamportTime MpiProgressCommunicator::enqueue(MessageType messageType, std::string_view message,
+                                             Iterator firstRecipient, Iterator lastRecipient) {
+    std::lock_guard<std::mutex> lock(stampingMutex);
+    const LamportTime lamportTime = tickLamportTime();
+    for (Iterator recipient = firstRecipient; recipient != lastRecipient; ++recipient) {
+        // Every recipient needs a frame of its own, as the sends complete independently
+        Frame frame = takeSpareFrame();
+        frame.resize(MpiOptimizedCommunicator::getFrameSize(message));
+        MpiOptimizedCommunicator::encode(frame.data(), lamportTime, messageType, message);
+        outboxes.at(static_cast<unsigned long>(*recipient))->push(std::move(frame));
+    }
+    return lamportTime;
+}
+
+MpiProgressCommunicator::Frame MpiProgressCommunicator::takeSpareFrame() {
+    if (spareFrames.empty()) {
+        return {};
+    }
+    Frame frame = std::move(spareFrames.back());
+    spareFrames.pop_back();
+    return frame;
+}
+
+void MpiProgressCommunicator::progressThreadFunction(int argc, char** argv, std::promise<void>& initialized) {
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &myProcessId);
+    MPI_Comm_size(MPI_COMM_WORLD, &numberOfProcesses);
+    if (provided < MPI_THREAD_FUNNELED) {
+        std::cerr << "[Process " << myProcessId << "] Your MPI implementation does not support MPI_THREAD_FUNNELED, "
+                                                   "calls from the progress thread may not be safe." << std::endl;
+    }
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        outboxes.push_back(std::make_unique<MpscQueue<Frame>>());
+        if (id != myProcessId) {
+            otherProcesses.insert(id);
+        }
+    }
+    initialized.set_value();
+
+    while (not terminate.load(std::memory_order_acquire)) {
+        // Every bit of progress starts the strategy over, so the thread only backs off while the traffic is idle
+        waitStrategy.waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+            return progress() or terminate.load(std::memory_order_acquire);
+        });
+    }
+    // Whatever has been sent before the destruction still leaves the process
+    while (postQueuedSends() or not inFlightSends.empty()) {
+        completeSends();
+    }
+    MPI_Finalize();
+}
+
+bool MpiProgressCommunicator::progress() {
+    bool progressed = postQueuedSends();
+    progressed |= completeSends();
+    progressed |= receiveArrived();
+    return progressed;
+}
+
+bool MpiProgressCommunicator::postQueuedSends() {
+    bool posted = false;
+    for (ProcessId recipient = 0; recipient < numberOfProcesses; ++recipient) {
+        while (std::optional<Frame> frame = outboxes[static_cast<unsigned long>(recipient)]->pop()) {
+            auto& send = inFlightSends.emplace_back(InFlightSend {.request = MPI_REQUEST_NULL, .frame = std::move(*frame)});
+            MPI_Isend(send.frame.data(), static_cast<int>(send.frame.size()), MPI_BYTE, recipient, MPI_DEFAULT_TAG,
+                      MPI_COMM_WORLD, &send.request);
+            posted = true;
+        }
+    }
+    return posted;
+}
+
+bool MpiProgressCommunicator::completeSends() {
+    bool completed = false;
+    for (std::size_t i = 0; i < inFlightSends.size();) {
+        int isDone;
+        MPI_Test(&inFlightSends[i].request, &isDone, MPI_STATUS_IGNORE);
+        if (isDone) {
+            completedFrames.push_back(std::move(inFlightSends[i].frame));
+            // Completion order does not matter, MPI keeps the order of the sends on every link
+            std::swap(inFlightSends[i], inFlightSends.back());
+            inFlightSends.pop_back();
+            completed = true;
+        } else {
+            ++i;
+        }
+    }
+    if (completed) {
+        std::lock_guard<std::mutex> lock(stampingMutex);
+        for (Frame& frame : completedFrames) {
+            if (spareFrames.size() < MPI_PROGRESS_SPARE_FRAMES) {
+                spareFrames.push_back(std::move(frame));
+            }
+        }
+        completedFrames.clear();
+    }
+    return completed;
+}
+
+bool MpiProgressCommunicator::receiveArrived() {
+    bool received = false;
+    while (true) {
+        MPI_Status status;
+        int hasArrived;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_DEFAULT_TAG, MPI_COMM_WORLD, &hasArrived, &status);
+        if (not hasArrived) {
+            return received;
+        }
+        int frameSize;
+        MPI_Get_count(&status, MPI_BYTE, &frameSize);
+        receiveBuffer.resize(static_cast<unsigned long>(frameSize));
+        MPI_Recv(receiveBuffer.data(), frameSize, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+        Packet packet;
+        MpiOptimizedCommunicator::decode(receiveBuffer.data(), receiveBuffer.size(), status.MPI_SOURCE, packet);
+        inbox.push(std::move(packet));
+        received = true;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef INC_3PC_MPIPROGRESSCOMMUNICATOR_H
+#define INC_3PC_MPIPROGRESSCOMMUNICATOR_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <mpi.h>
+#include <util/Mailbox.h>
+#include <util/MpscQueue.h>
+#include <util/WaitStrategy.h>
+#include "ICommunicator.h"
+
+/** Number of frames of completed sends kept for reuse */
+#define MPI_PROGRESS_SPARE_FRAMES 256
+
+/**
+ * Communicator in which a single progress thread owns all the MPI calls, so MPI_THREAD_FUNNELED is all it needs from
+ * the MPI implementation. Sending threads only stamp and encode the packet under a short lock, so that the timestamps
+ * keep growing along every link, and push the frame into the lock-free queue of its destination. The progress thread
+ * posts the queued frames as non-blocking sends, polls for incoming frames and hands them over to the receiving thread
+ * through a mailbox. Frames are encoded the same way as in MpiOptimizedCommunicator.
+ */
+class MpiProgressCommunicator : public ICommunicator {
+public:
+
+    /**
+     * @param waitStrategy how the progress thread waits while there is nothing to send or receive. It has to poll MPI
+     * for the incoming frames anyway, so its sleeps are kept short - WaitStrategy::yielding() takes a whole core for
+     * the lowest latency instead.
+     */
+    MpiProgressCommunicator(int argc, char** argv,
+                            WaitStrategy waitStrategy = WaitStrategy::backingOff(
+                                    std::chrono::microseconds(POLLING_MAX_SLEEP_MICROS)));
+
+    ~MpiProgressCommunicator();
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients) override;
+
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient) override;
+
+    Packet sendOthers(MessageType messageType, const std::string& message) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients) override;
+
+    using ICommunicator::post;
+
+    Packet receive() override;
+
+    std::optional<Packet> receive(long timeoutMillis) override;
+
+protected:
+
+    using Frame = std::vector<char>;
+
+    struct InFlightSend {
+        MPI_Request request;
+        /** Moving a vector keeps its buffer in place, so MPI can keep reading it while the vector of sends grows */
+        Frame frame;
+    };
+
+    /**
+     * Stamps and encodes the packet and pushes it into the outboxes of the recipients in one step, so that a frame
+     * stamped later never gets ahead of an earlier one on the same link.
+     * @return timestamp of the frame
+     */
+    template <typename Iterator>
+    LamportTime enqueue(MessageType messageType, std::string_view message, Iterator firstRecipient,
+                        Iterator lastRecipient);
+
+    /** Has to be called with 'stampingMutex' held. @return a spare frame if there is any, an empty one otherwise */
+    Frame takeSpareFrame();
+
+    void progressThreadFunction(int argc, char** argv, std::promise<void>& initialized);
+
+    /**
+     * Posts the queued frames, completes the finished sends and takes in the arrived frames.
+     * @return whether anything has been done
+     */
+    bool progress();
+
+    bool postQueuedSends();
+
+    bool completeSends();
+
+    bool receiveArrived();
+
+    WaitStrategy waitStrategy;
+    std::atomic<bool> terminate = false;
+    std::thread progressThread;
+    /** Also guards 'spareFrames' */
+    std::mutex stampingMutex;
+
+    /** Indexed by the recipient, filled by the progress thread before the constructor returns */
+    std::vector<std::unique_ptr<MpscQueue<Frame>>> outboxes;
+    Mailbox<Packet> inbox;
+
+    /** Frames of the completed sends, whose buffers are reused so that steady-state sends do not allocate them */
+    std::vector<Frame> spareFrames;
+
+    /** Only touched by the progress thread */
+    std::vector<InFlightSend> inFlightSends;
+    /** Frames of the sends completed by a single completeSends(), on their way to 'spareFrames' */
+    std::vector<Frame> completedFrames;
+    std::string receiveBuffer;
+};
+
+#endif //INC_3PC_MPIPROGRESSCOMMUNICATOR_H
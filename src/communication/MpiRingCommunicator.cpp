@@ -0,0 +1,180 @@
+#include "MpiRingCommunicator.h"
+#include <cstring>
+#include <logging/Logger.h>
+#include <util/StringConcat.h>
+
+Packet MpiRingCommunicator::send(MessageType messageType, const std::string& message,
+                                 const std::unordered_set<ProcessId>& recipients, MpiTag tag) {
+    if (recipients.size() == 1 and isRingTraffic(message, *recipients.begin(), tag)) {
+        return Packet {
+                .lamportTime = sendToSuccessor(messageType, message),
+                .source = myProcessId,
+                .messageType = messageType,
+                .message = message
+        };
+    }
+    return MpiOptimizedCommunicator::send(messageType, message, recipients, tag);
+}
+
+Packet MpiRingCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient, MpiTag tag) {
+    if (isRingTraffic(message, recipient, tag)) {
+        return Packet {
+                .lamportTime = sendToSuccessor(messageType, message),
+                .source = myProcessId,
+                .messageType = messageType,
+                .message = message
+        };
+    }
+    return MpiOptimizedCommunicator::send(messageType, message, recipient, tag);
+}
+
+LamportTime MpiRingCommunicator::post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                      std::size_t numberOfRecipients, MpiTag tag) {
+    if (numberOfRecipients == 1 and isRingTraffic(message, *recipients, tag)) {
+        return sendToSuccessor(messageType, message);
+    }
+    return MpiOptimizedCommunicator::post(messageType, message, recipients, numberOfRecipients, tag);
+}
+
+Packet MpiRingCommunicator::receive(MpiTag tag) {
+    if (tag != MPI_ANY_TAG) {
+        return MpiOptimizedCommunicator::receive(tag);
+    }
+    int slot;
+    MPI_Status status;
+    Packet packet;
+    MPI_Waitany(static_cast<int>(receiveRequests.size()), receiveRequests.data(), &slot, &status);
+    consumeReceive(slot, status, packet);
+    return packet;
+}
+
+std::optional<Packet> MpiRingCommunicator::receive(long timeoutMillis, MpiTag tag) {
+    if (tag != MPI_ANY_TAG) {
+        return MpiOptimizedCommunicator::receive(timeoutMillis, tag);
+    }
+    int slot;
+    int hasReceivedData;
+    MPI_Status status;
+
+    if (not waitStrategy.waitFor(timeoutMillis, [&]() {
+        MPI_Testany(static_cast<int>(receiveRequests.size()), receiveRequests.data(), &slot, &hasReceivedData, &status);
+        return hasReceivedData;
+    })) {
+        return std::nullopt;
+    }
+    Packet packet;
+    consumeReceive(slot, status, packet);
+    return packet;
+}
+
+void MpiRingCommunicator::receive(const PacketConsumer& consumer) {
+    int slot;
+    MPI_Status status;
+    MPI_Waitany(static_cast<int>(receiveRequests.size()), receiveRequests.data(), &slot, &status);
+    consumeReceive(slot, status, receivedPacket);
+    consumer(receivedPacket);
+}
+
+bool MpiRingCommunicator::isRingTraffic(std::string_view message, ProcessId recipient, MpiTag tag) const {
+    return recipient == successor and tag == MPI_DEFAULT_TAG and
+           sizeof(EncodedNextPacketLength) + getFrameSize(message) <= MPI_RING_FRAME_SIZE;
+}
+
+std::size_t MpiRingCommunicator::getMaxFrameSize() const {
+    return MPI_MAX_FRAME_SIZE;
+}
+
+LamportTime MpiRingCommunicator::sendToSuccessor(MessageType messageType, std::string_view message) {
+    std::lock_guard<std::recursive_mutex> lock(communicationMutex);
+    const LamportTime lamportTime = tickLamportTime();
+    const auto frameLength = static_cast<EncodedNextPacketLength>(
+            encode(successorFrame.data() + sizeof(EncodedNextPacketLength), lamportTime, messageType, message));
+    std::memcpy(successorFrame.data(), &frameLength, sizeof(frameLength));
+
+    MPI_Start(&successorSend);
+    MPI_Wait(&successorSend, MPI_STATUS_IGNORE);
+    return lamportTime;
+}
+
+void MpiRingCommunicator::consumeReceive(int slot, const MPI_Status& status, Packet& packet) {
+    if (slot == PREDECESSOR) {
+        EncodedNextPacketLength frameLength;
+        std::memcpy(&frameLength, predecessorFrame.data(), sizeof(frameLength));
+        decode(predecessorFrame.data() + sizeof(frameLength), frameLength, predecessor, packet);
+    } else {
+        int frameLength;
+        MPI_Get_count(&status, MPI_BYTE, &frameLength);
+        decodeReceived(genericFrames[slot - GENERIC].data(), static_cast<std::size_t>(frameLength), status, packet);
+    }
+    restartReceive(slot);
+    updateTimestamp(packet);
+}
+
+void MpiRingCommunicator::restartReceive(int slot) {
+    if (slot == PREDECESSOR) {
+        MPI_Start(&receiveRequests[PREDECESSOR]);
+    } else {
+        MpiTag tag = slot == GENERIC ? MPI_DEFAULT_TAG : MPI_BROADCAST_TAG;
+        MPI_Irecv(genericFrames[slot - GENERIC].data(), MPI_MAX_FRAME_SIZE, MPI_BYTE, MPI_ANY_SOURCE, tag,
+                  mpiCommunicator, &receiveRequests[slot]);
+    }
+}
+
+void MpiRingCommunicator::createRingTopology() {
+    const int worldRank = myProcessId;
+    const int dimensions[] = {numberOfProcesses};
+    const int periodic[] = {1};
+    MPI_Comm ringCommunicator;
+    MPI_Cart_create(MPI_COMM_WORLD, 1, dimensions, periodic, 1, &ringCommunicator);
+
+    // The ring follows the ranks MPI has chosen, so the neighbours are whichever processes it has placed next to each
+    // other. Following the successors from world rank 0 gives the ids, so that the process reading the standard input
+    // keeps id 0
+    int ringRank;
+    int ringPredecessor;
+    int ringSuccessor;
+    MPI_Comm_rank(ringCommunicator, &ringRank);
+    MPI_Cart_shift(ringCommunicator, 0, 1, &ringPredecessor, &ringSuccessor);
+    std::vector<int> successorsOfRanks(static_cast<unsigned long>(numberOfProcesses));
+    MPI_Allgather(&ringSuccessor, 1, MPI_INT, successorsOfRanks.data(), 1, MPI_INT, ringCommunicator);
+    int ringRankOfWorldRoot = ringRank;
+    MPI_Bcast(&ringRankOfWorldRoot, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<int> ranks(static_cast<unsigned long>(numberOfProcesses));
+    for (ProcessId id = 0, rank = ringRankOfWorldRoot; id < numberOfProcesses; ++id, rank = successorsOfRanks[rank]) {
+        ranks[id] = rank;
+    }
+    useCommunicator(ringCommunicator, std::move(ranks));
+
+    successor = (myProcessId + 1) % numberOfProcesses;
+    predecessor = (myProcessId - 1 + numberOfProcesses) % numberOfProcesses;
+    Logger::log<LogLevel::INFO>([&]() {
+        return util::concat("World rank ", worldRank, " placed on rank ", ringRank, " of the ring topology as process ",
+                            myProcessId);
+    });
+}
+
+MpiRingCommunicator::MpiRingCommunicator(int argc, char** argv, bool useRingTopology)
+        : MpiOptimizedCommunicator(argc, argv),
+          successor((myProcessId + 1) % numberOfProcesses),
+          predecessor((myProcessId - 1 + numberOfProcesses) % numberOfProcesses) {
+
+    if (useRingTopology) {
+        createRingTopology();
+    }
+    MPI_Send_init(successorFrame.data(), MPI_RING_FRAME_SIZE, MPI_BYTE, toRank(successor), MPI_RING_TAG,
+                  mpiCommunicator, &successorSend);
+    MPI_Recv_init(predecessorFrame.data(), MPI_RING_FRAME_SIZE, MPI_BYTE, toRank(predecessor), MPI_RING_TAG,
+                  mpiCommunicator, &receiveRequests[PREDECESSOR]);
+    restartReceive(PREDECESSOR);
+    restartReceive(GENERIC);
+    restartReceive(BROADCAST);
+}
+
+MpiRingCommunicator::~MpiRingCommunicator() {
+    for (MPI_Request& request : receiveRequests) {
+        MPI_Cancel(&request);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    MPI_Request_free(&receiveRequests[PREDECESSOR]);
+    MPI_Request_free(&successorSend);
+}
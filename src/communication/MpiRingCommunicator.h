@@ -0,0 +1,79 @@
+#ifndef INC_3PC_MPIRINGCOMMUNICATOR_H
+#define INC_3PC_MPIRINGCOMMUNICATOR_H
+
+#include <array>
+#include "MpiOptimizedCommunicator.h"
+
+#define MPI_RING_TAG 1
+/** Fixed size of every frame sent over a ring link - persistent requests cannot change their count */
+#define MPI_RING_FRAME_SIZE 64
+
+/**
+ * Communicator optimized for traffic flowing along the ring. Untagged packets sent to the successor travel over a
+ * persistent MPI_Send_init request and packets from the predecessor arrive through a persistent MPI_Recv_init one, so
+ * the hot path only calls MPI_Start and waits. Any other traffic (e.g. CRASH requests from process 0) takes the generic
+ * path and is received through a single preposted MPI_Irecv on the default tag (plus one for relayed broadcasts).
+ */
+class MpiRingCommunicator : public MpiOptimizedCommunicator {
+public:
+
+    /**
+     * @param useRingTopology if set, the ring is described to MPI as a periodic 1-D Cartesian topology with reordering
+     * allowed, and the ring then follows the ranks of the new communicator - so an MPI which maps the ranks onto the
+     * hardware makes the neighbours in the ring close to each other. The ids are rotated so that world rank 0, which
+     * reads the standard input, keeps id 0, the others may differ from their MPI_COMM_WORLD ranks. The placement is
+     * logged.
+     */
+    MpiRingCommunicator(int argc, char** argv, bool useRingTopology = false);
+
+    ~MpiRingCommunicator() override;
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, MpiTag tag) override;
+
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient, MpiTag tag) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients, MpiTag tag) override;
+
+    using MpiOptimizedCommunicator::send;
+
+    using MpiOptimizedCommunicator::post;
+
+    Packet receive(MpiTag tag) override;
+
+    std::optional<Packet> receive(long timeoutMillis, MpiTag tag) override;
+
+    void receive(const PacketConsumer& consumer) override;
+
+    using MpiOptimizedCommunicator::receive;
+
+protected:
+
+    enum ReceiveSlot : int {
+        PREDECESSOR = 0, GENERIC = 1, BROADCAST = 2
+    };
+
+    /** Moves the traffic over to a Cartesian communicator describing the ring */
+    void createRingTopology();
+
+    bool isRingTraffic(std::string_view message, ProcessId recipient, MpiTag tag) const;
+
+    std::size_t getMaxFrameSize() const override;
+
+    LamportTime sendToSuccessor(MessageType messageType, std::string_view message);
+
+    /** Decodes the completed receive and restarts it */
+    void consumeReceive(int slot, const MPI_Status& status, Packet& packet);
+
+    void restartReceive(int slot);
+
+    ProcessId successor;
+    ProcessId predecessor;
+    MPI_Request successorSend = MPI_REQUEST_NULL;
+    std::array<MPI_Request, 3> receiveRequests {MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    std::array<char, MPI_RING_FRAME_SIZE> successorFrame {};
+    std::array<char, MPI_RING_FRAME_SIZE> predecessorFrame {};
+    std::array<std::array<char, MPI_MAX_FRAME_SIZE>, 2> genericFrames {};
+};
+
+#endif //INC_3PC_MPIRINGCOMMUNICATOR_H
@@ -0,0 +1,186 @@
+#include "MpiRmaCommunicator.h"
+#include <cstring>
+
+namespace {
+    const uint64_t oneFrame = 1;
+}
+
+Packet MpiRmaCommunicator::send(MessageType messageType, const std::string& message,
+                                const std::unordered_set<ProcessId>& recipients, MpiTag tag) {
+    if (isWindowTraffic(message, tag)) {
+        return Packet {
+                .lamportTime = putFrame(messageType, message, recipients.begin(), recipients.end()),
+                .source = myProcessId,
+                .messageType = messageType,
+                .message = message
+        };
+    }
+    return MpiOptimizedCommunicator::send(messageType, message, recipients, tag);
+}
+
+Packet MpiRmaCommunicator::send(MessageType messageType, const std::string& message, ProcessId recipient, MpiTag tag) {
+    if (isWindowTraffic(message, tag)) {
+        return Packet {
+                .lamportTime = putFrame(messageType, message, &recipient, &recipient + 1),
+                .source = myProcessId,
+                .messageType = messageType,
+                .message = message
+        };
+    }
+    return MpiOptimizedCommunicator::send(messageType, message, recipient, tag);
+}
+
+LamportTime MpiRmaCommunicator::post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                     std::size_t numberOfRecipients, MpiTag tag) {
+    if (isWindowTraffic(message, tag)) {
+        return putFrame(messageType, message, recipients, recipients + numberOfRecipients);
+    }
+    return MpiOptimizedCommunicator::post(messageType, message, recipients, numberOfRecipients, tag);
+}
+
+Packet MpiRmaCommunicator::receive(MpiTag tag) {
+    if (tag != MPI_ANY_TAG and tag != MPI_DEFAULT_TAG) {
+        return MpiOptimizedCommunicator::receive(tag);
+    }
+    // Nothing notifies the process about frames put into its window, so it has to poll
+    Packet packet;
+    waitStrategy.waitUntil(std::chrono::steady_clock::time_point::max(), [&]() { return pollPacket(tag, packet); });
+    return packet;
+}
+
+std::optional<Packet> MpiRmaCommunicator::receive(long timeoutMillis, MpiTag tag) {
+    if (tag != MPI_ANY_TAG and tag != MPI_DEFAULT_TAG) {
+        return MpiOptimizedCommunicator::receive(timeoutMillis, tag);
+    }
+    Packet packet;
+    if (not waitStrategy.waitFor(timeoutMillis, [&]() { return pollPacket(tag, packet); })) {
+        return std::nullopt;
+    }
+    return packet;
+}
+
+bool MpiRmaCommunicator::isWindowTraffic(std::string_view message, MpiTag tag) const {
+    return tag == MPI_DEFAULT_TAG and sizeof(EncodedNextPacketLength) + getFrameSize(message) <= MPI_RMA_SLOT_SIZE;
+}
+
+std::size_t MpiRmaCommunicator::getMaxFrameSize() const {
+    return MPI_MAX_FRAME_SIZE;
+}
+
+template <typename Iterator>
+LamportTime MpiRmaCommunicator::putFrame(MessageType messageType, std::string_view message, Iterator firstRecipient,
+                                         Iterator lastRecipient) {
+    std::lock_guard<std::recursive_mutex> lock(communicationMutex);
+    const LamportTime lamportTime = tickLamportTime();
+    const auto frameLength = static_cast<EncodedNextPacketLength>(
+            encode(outgoingFrame.data() + sizeof(EncodedNextPacketLength), lamportTime, messageType, message));
+    std::memcpy(outgoingFrame.data(), &frameLength, sizeof(frameLength));
+    const int slotLength = static_cast<int>(sizeof(frameLength) + frameLength);
+
+    for (Iterator recipient = firstRecipient; recipient != lastRecipient; ++recipient) {
+        waitForFreeSlot(*recipient);
+        const int rank = toRank(*recipient);
+        MPI_Put(outgoingFrame.data(), slotLength, MPI_BYTE, rank,
+                getSlotDisplacement(myProcessId, sentFrames[*recipient]), slotLength, MPI_BYTE, window);
+        // Puts and accumulates are not ordered, so the frame has to land before the head counter announces it
+        MPI_Win_flush(rank, window);
+        MPI_Accumulate(&oneFrame, 1, MPI_UINT64_T, rank, getHeadDisplacement(myProcessId), 1, MPI_UINT64_T, MPI_SUM,
+                       window);
+        MPI_Win_flush(rank, window);
+        ++sentFrames[*recipient];
+    }
+    return lamportTime;
+}
+
+void MpiRmaCommunicator::waitForFreeSlot(ProcessId recipient) {
+    if (sentFrames[recipient] - knownConsumedFrames[recipient] < MPI_RMA_SLOTS) {
+        return;
+    }
+    waitStrategy.waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+        MPI_Fetch_and_op(nullptr, &knownConsumedFrames[recipient], MPI_UINT64_T, toRank(recipient),
+                         getTailDisplacement(myProcessId), MPI_NO_OP, window);
+        MPI_Win_flush(toRank(recipient), window);
+        return sentFrames[recipient] - knownConsumedFrames[recipient] < MPI_RMA_SLOTS;
+    });
+}
+
+bool MpiRmaCommunicator::drainWindow() {
+    // Head counters are only read atomically, as the other processes may be bumping them at the same time
+    const int myRank = toRank(myProcessId);
+    MPI_Get_accumulate(nullptr, 0, MPI_UINT64_T, arrivedFrames.data(), numberOfProcesses, MPI_UINT64_T, myRank,
+                       getHeadDisplacement(0), numberOfProcesses, MPI_UINT64_T, MPI_NO_OP, window);
+    MPI_Win_flush(myRank, window);
+    MPI_Win_sync(window);
+
+    bool drained = false;
+    for (ProcessId source = 0; source < numberOfProcesses; ++source) {
+        if (consumedFrames[source] == arrivedFrames[source]) {
+            continue;
+        }
+        for (; consumedFrames[source] < arrivedFrames[source]; ++consumedFrames[source]) {
+            const char* slot = windowMemory + getSlotDisplacement(source, consumedFrames[source]);
+            EncodedNextPacketLength frameLength;
+            std::memcpy(&frameLength, slot, sizeof(frameLength));
+            decode(slot + sizeof(frameLength), frameLength, source, windowPackets.emplace_back());
+        }
+        // The frames have been copied out, so the slots can go back to the sender
+        MPI_Accumulate(&consumedFrames[source], 1, MPI_UINT64_T, myRank, getTailDisplacement(source), 1,
+                       MPI_UINT64_T, MPI_REPLACE, window);
+        drained = true;
+    }
+    if (drained) {
+        MPI_Win_flush(myRank, window);
+    }
+    return drained;
+}
+
+bool MpiRmaCommunicator::pollPacket(MpiTag tag, Packet& packet) {
+    if (not windowPackets.empty() or drainWindow()) {
+        packet = std::move(windowPackets.front());
+        windowPackets.pop_front();
+        updateTimestamp(packet);
+        return true;
+    }
+    int hasArrived;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, tag, mpiCommunicator, &hasArrived, &status);
+    if (hasArrived) {
+        packet = MpiOptimizedCommunicator::receive(status.MPI_TAG);
+    }
+    return hasArrived;
+}
+
+MPI_Aint MpiRmaCommunicator::getHeadDisplacement(ProcessId source) {
+    return static_cast<MPI_Aint>(source * sizeof(uint64_t));
+}
+
+MPI_Aint MpiRmaCommunicator::getTailDisplacement(ProcessId source) const {
+    return static_cast<MPI_Aint>((numberOfProcesses + source) * sizeof(uint64_t));
+}
+
+MPI_Aint MpiRmaCommunicator::getSlotDisplacement(ProcessId source, uint64_t frameIndex) const {
+    const auto slotsOffset = static_cast<MPI_Aint>(2 * numberOfProcesses * sizeof(uint64_t));
+    const auto slot = static_cast<MPI_Aint>(source) * MPI_RMA_SLOTS + static_cast<MPI_Aint>(frameIndex % MPI_RMA_SLOTS);
+    return slotsOffset + slot * MPI_RMA_SLOT_SIZE;
+}
+
+MpiRmaCommunicator::MpiRmaCommunicator(int argc, char** argv, WaitStrategy waitStrategy)
+        : MpiOptimizedCommunicator(argc, argv),
+          sentFrames(numberOfProcesses), knownConsumedFrames(numberOfProcesses),
+          arrivedFrames(numberOfProcesses), consumedFrames(numberOfProcesses) {
+
+    setWaitStrategy(waitStrategy);
+
+    // Head and tail counters of all the processes followed by their slots
+    const MPI_Aint windowSize = getSlotDisplacement(numberOfProcesses, 0);
+    MPI_Win_allocate(windowSize, 1, MPI_INFO_NULL, mpiCommunicator, &windowMemory, &window);
+    std::memset(windowMemory, 0, static_cast<std::size_t>(windowSize));
+    // Nobody may write into a window before it is cleared
+    MPI_Barrier(mpiCommunicator);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+}
+
+MpiRmaCommunicator::~MpiRmaCommunicator() {
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+}
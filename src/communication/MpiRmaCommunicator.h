@@ -0,0 +1,92 @@
+#ifndef INC_3PC_MPIRMACOMMUNICATOR_H
+#define INC_3PC_MPIRMACOMMUNICATOR_H
+
+#include <array>
+#include <deque>
+#include "MpiOptimizedCommunicator.h"
+
+/** Number of frames every process is able to leave in the window of another one before it has to wait */
+#define MPI_RMA_SLOTS 16
+/** Size of a single slot, including the length prefix of the frame */
+#define MPI_RMA_SLOT_SIZE 64
+
+/**
+ * Communicator which delivers small untagged packets by writing them straight into the memory of the recipient.
+ * Every process exposes a window holding, for every other process, a ring of MPI_RMA_SLOTS frame slots together with
+ * a head counter (bumped by the sender with MPI_Accumulate once its MPI_Put of the frame is flushed) and a tail
+ * counter (advanced by the recipient as it consumes the frames). The window is accessed in a single passive-target
+ * epoch opened by MPI_Win_lock_all, so no call needs the target to take part.
+ *
+ * Packets which do not fit into a slot, tagged ones and relayed broadcasts take the two-sided path of
+ * MpiOptimizedCommunicator, so they are not ordered with respect to the packets travelling through the window.
+ */
+class MpiRmaCommunicator : public MpiOptimizedCommunicator {
+public:
+
+    /**
+     * @param waitStrategy how receiving threads poll the window. Nothing notifies them about the frames put into it,
+     * so their sleeps are kept short - WaitStrategy::yielding() takes a whole core for the lowest latency instead.
+     */
+    MpiRmaCommunicator(int argc, char** argv,
+                       WaitStrategy waitStrategy = WaitStrategy::backingOff(
+                               std::chrono::microseconds(POLLING_MAX_SLEEP_MICROS)));
+
+    ~MpiRmaCommunicator() override;
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, MpiTag tag) override;
+
+    Packet send(MessageType messageType, const std::string& message, ProcessId recipient, MpiTag tag) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients, MpiTag tag) override;
+
+    using MpiOptimizedCommunicator::send;
+
+    using MpiOptimizedCommunicator::post;
+
+    Packet receive(MpiTag tag) override;
+
+    std::optional<Packet> receive(long timeoutMillis, MpiTag tag) override;
+
+    using MpiOptimizedCommunicator::receive;
+
+protected:
+
+    bool isWindowTraffic(std::string_view message, MpiTag tag) const;
+
+    std::size_t getMaxFrameSize() const override;
+
+    template <typename Iterator>
+    LamportTime putFrame(MessageType messageType, std::string_view message, Iterator firstRecipient,
+                         Iterator lastRecipient);
+
+    /** Has to be called with 'communicationMutex' held */
+    void waitForFreeSlot(ProcessId recipient);
+
+    /** Moves every frame waiting in the window into 'windowPackets'. @return whether there was any */
+    bool drainWindow();
+
+    /** Takes a packet either from the window or from the two-sided path, if one has arrived */
+    bool pollPacket(MpiTag tag, Packet& packet);
+
+    static MPI_Aint getHeadDisplacement(ProcessId source);
+
+    MPI_Aint getTailDisplacement(ProcessId source) const;
+
+    MPI_Aint getSlotDisplacement(ProcessId source, uint64_t frameIndex) const;
+
+    MPI_Win window = MPI_WIN_NULL;
+    char* windowMemory = nullptr;
+
+    /** Sending side, guarded by 'communicationMutex' */
+    std::vector<uint64_t> sentFrames;
+    std::vector<uint64_t> knownConsumedFrames;
+    std::array<char, MPI_RMA_SLOT_SIZE> outgoingFrame {};
+
+    /** Receiving side, only touched by the receiving thread */
+    std::vector<uint64_t> arrivedFrames;
+    std::vector<uint64_t> consumedFrames;
+    std::deque<Packet> windowPackets;
+};
+
+#endif //INC_3PC_MPIRMACOMMUNICATOR_H
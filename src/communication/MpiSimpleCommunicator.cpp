@@ -1,23 +1,32 @@
 #include "MpiSimpleCommunicator.h"
 #include <iostream>
+#include <vector>
 
 Packet MpiSimpleCommunicator::send(MessageType messageType, const std::string& message,
                                    const std::unordered_set<ProcessId>& recipients, MpiTag tag) {
 
-    std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-
-    RawPacket rawPacket {
-            .lamportTime = static_cast<EncodedLamportTime>(++currentLamportTime),
-            .messageType = static_cast<EncodedMessageType>(messageType),
-            .nextPacketLength = static_cast<EncodedNextPacketLength>(message.size()),
-    };
+    RawPacket rawPacket;
+    std::vector<MPI_Request> requests;
+    requests.reserve(2 * recipients.size());
+    {
+        // Only posting the sends happens under the lock, all of them are then completed at once
+        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
 
-    for (ProcessId recipient : recipients) {
-        MPI_Send(&rawPacket, 1, mpiRawPacketType, recipient, tag, MPI_COMM_WORLD);
-        if (not message.empty()) {
-            MPI_Send(message.c_str(), static_cast<int>(message.size()), MPI_CHAR, recipient, tag, MPI_COMM_WORLD);
+        rawPacket = {
+                .lamportTime = static_cast<EncodedLamportTime>(tickLamportTime()),
+                .messageType = static_cast<EncodedMessageType>(messageType),
+                .nextPacketLength = static_cast<EncodedNextPacketLength>(message.size()),
+        };
+
+        for (ProcessId recipient : recipients) {
+            MPI_Isend(&rawPacket, 1, mpiRawPacketType, toRank(recipient), tag, mpiCommunicator, &requests.emplace_back());
+            if (not message.empty()) {
+                MPI_Isend(message.c_str(), static_cast<int>(message.size()), MPI_CHAR, toRank(recipient), tag, mpiCommunicator,
+                          &requests.emplace_back());
+            }
         }
     }
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
 
     Packet packet {
             .lamportTime = rawPacket.lamportTime,
@@ -32,20 +41,17 @@ Packet MpiSimpleCommunicator::send(MessageType messageType, const std::string& m
 Packet MpiSimpleCommunicator::receive(MpiTag tag) {
     MPI_Status status;
     RawPacket rawPacket;
-    MPI_Recv(&rawPacket, 1, mpiRawPacketType, MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &status);
-    ProcessId source = status.MPI_SOURCE;
+    MPI_Recv(&rawPacket, 1, mpiRawPacketType, MPI_ANY_SOURCE, tag, mpiCommunicator, &status);
+    const int sourceRank = status.MPI_SOURCE;
 
     std::string message;
     uint32_t messageLength = rawPacket.nextPacketLength;
     if (messageLength > 0) {
         message.resize(messageLength);
-        MPI_Recv(message.data(), messageLength, MPI_CHAR, source, tag, MPI_COMM_WORLD, &status);
+        MPI_Recv(message.data(), messageLength, MPI_CHAR, sourceRank, tag, mpiCommunicator, &status);
     }
-    {
-        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-        currentLamportTime = std::max(rawPacket.lamportTime, currentLamportTime) + 1;
-    }
-    return toPacket(rawPacket, source, message);
+    mergeLamportTime(rawPacket.lamportTime);
+    return toPacket(rawPacket, toProcessId(sourceRank), message);
 }
 
 Packet MpiSimpleCommunicator::receive() {
@@ -53,40 +59,38 @@ Packet MpiSimpleCommunicator::receive() {
 }
 
 std::optional<Packet> MpiSimpleCommunicator::receive(long timeoutMillis, MpiTag tag) {
-    using namespace std::chrono;
     MPI_Status status;
     int hasReceivedData;
     RawPacket rawPacket;
-    auto timeStarted = system_clock::now();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
 
     {
         MPI_Request request;
-        MPI_Irecv(&rawPacket, 1, mpiRawPacketType, MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &request);
+        MPI_Irecv(&rawPacket, 1, mpiRawPacketType, MPI_ANY_SOURCE, tag, mpiCommunicator, &request);
 
-        do {
+        if (not waitStrategy.waitUntil(deadline, [&]() {
             MPI_Test(&request, &hasReceivedData, &status);
-        } while (not hasReceivedData and duration_cast<milliseconds>(system_clock::now() - timeStarted).count() < timeoutMillis);
-        if (not hasReceivedData) {
+            return hasReceivedData;
+        })) {
             MPI_Cancel(&request);
             MPI_Request_free(&request);
             return std::nullopt;
         }
     }
 
-    ProcessId source = status.MPI_SOURCE;
+    const int sourceRank = status.MPI_SOURCE;
     std::string message;
     uint32_t messageLength = rawPacket.nextPacketLength;
     message.resize(messageLength);
     if (messageLength > 0) {
         {
             MPI_Request request;
-            MPI_Irecv(message.data(), messageLength, MPI_CHAR, source, tag, MPI_COMM_WORLD, &request);
+            MPI_Irecv(message.data(), messageLength, MPI_CHAR, sourceRank, tag, mpiCommunicator, &request);
 
-            do {
+            if (not waitStrategy.waitUntil(deadline, [&]() {
                 MPI_Test(&request, &hasReceivedData, &status);
-            } while (not hasReceivedData and
-                     duration_cast<milliseconds>(system_clock::now() - timeStarted).count() < timeoutMillis);
-            if (not hasReceivedData) {
+                return hasReceivedData;
+            })) {
                 MPI_Cancel(&request);
                 MPI_Request_free(&request);
                 return std::nullopt;
@@ -94,11 +98,8 @@ std::optional<Packet> MpiSimpleCommunicator::receive(long timeoutMillis, MpiTag
         }
     }
 
-    {
-        std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-        currentLamportTime = std::max(rawPacket.lamportTime, currentLamportTime) + 1;
-    }
-    return toPacket(rawPacket, source, message);
+    mergeLamportTime(rawPacket.lamportTime);
+    return toPacket(rawPacket, toProcessId(sourceRank), message);
 }
 
 std::optional<Packet> MpiSimpleCommunicator::receive(long timeoutMillis) {
@@ -106,6 +107,36 @@ std::optional<Packet> MpiSimpleCommunicator::receive(long timeoutMillis) {
 }
 
 
+void MpiSimpleCommunicator::setWaitStrategy(WaitStrategy strategy) {
+    waitStrategy = strategy;
+}
+
+void MpiSimpleCommunicator::useCommunicator(MPI_Comm communicator, std::vector<int> ranks) {
+    mpiCommunicator = communicator;
+    ranksOfProcesses = std::move(ranks);
+    processesOfRanks.assign(ranksOfProcesses.size(), 0);
+    for (ProcessId process = 0; process < static_cast<ProcessId>(ranksOfProcesses.size()); ++process) {
+        processesOfRanks[ranksOfProcesses[process]] = process;
+    }
+    int myRank;
+    MPI_Comm_rank(mpiCommunicator, &myRank);
+    myProcessId = toProcessId(myRank);
+    otherProcesses.clear();
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        if (id != myProcessId) {
+            otherProcesses.insert(id);
+        }
+    }
+}
+
+int MpiSimpleCommunicator::toRank(ProcessId process) const {
+    return ranksOfProcesses.empty() ? process : ranksOfProcesses[process];
+}
+
+ProcessId MpiSimpleCommunicator::toProcessId(int rank) const {
+    return processesOfRanks.empty() ? rank : processesOfRanks[rank];
+}
+
 MpiTag MpiSimpleCommunicator::getDefaultTag() const {
     return MPI_DEFAULT_TAG;
 }
@@ -141,8 +172,6 @@ MpiSimpleCommunicator::MpiSimpleCommunicator(int argc, char** argv) {
         }
     }
     /**************************************************************************/
-
-    currentLamportTime = 0;
 }
 
 Packet MpiSimpleCommunicator::toPacket(RawPacket rawPacket, ProcessId source, std::string message) {
@@ -154,11 +183,9 @@ Packet MpiSimpleCommunicator::toPacket(RawPacket rawPacket, ProcessId source, st
     };
 }
 
-LamportTime MpiSimpleCommunicator::getCurrentLamportTime() {
-    std::lock_guard<std::recursive_mutex> lock(communicationMutex);
-    return currentLamportTime;
-}
-
 MpiSimpleCommunicator::~MpiSimpleCommunicator() {
+    if (mpiCommunicator != MPI_COMM_WORLD) {
+        MPI_Comm_free(&mpiCommunicator);
+    }
     MPI_Finalize();
 }
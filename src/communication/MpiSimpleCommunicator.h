@@ -3,6 +3,8 @@
 
 #include <mpi.h>
 #include <mutex>
+#include <vector>
+#include <util/WaitStrategy.h>
 #include "ITaggedCommunicator.h"
 
 #define MPI_DEFAULT_TAG 0
@@ -11,9 +13,11 @@
 #define MPI_ENCODED_LAMPORT_TIME MPI_UINT64_T
 #define MPI_ENCODED_MESSAGE_TYPE MPI_UINT8_T
 #define MPI_NEXT_PACKET_LENGTH MPI_UINT32_T
+#define MPI_ENCODED_PROCESS_ID MPI_INT32_T
 using EncodedLamportTime = uint64_t;
 using EncodedMessageType = uint8_t;
 using EncodedNextPacketLength = uint32_t;
+using EncodedProcessId = int32_t;
 
 struct RawPacket {
     EncodedLamportTime lamportTime;
@@ -47,6 +51,8 @@ public:
 
     Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, MpiTag tag) override;
 
+    using ITaggedCommunicator<MpiTag>::send;
+
     Packet receive(MpiTag tag) override;
 
     Packet receive() override;
@@ -57,7 +63,8 @@ public:
 
     MpiTag getDefaultTag() const override;
 
-    LamportTime getCurrentLamportTime() override;
+    /** Sets how receives with a timeout wait for the data to arrive */
+    void setWaitStrategy(WaitStrategy strategy);
 
     MpiSimpleCommunicator(int argc, char** argv);
 
@@ -67,8 +74,26 @@ protected:
 
     static Packet toPacket(RawPacket rawPacket, ProcessId source, std::string message);
 
+    /**
+     * Moves all the traffic over to another communicator, in which process 'id' has rank 'ranks[id]', and takes over
+     * the id assigned to the rank of this process. Has to be called by all the processes before anything is sent.
+     */
+    void useCommunicator(MPI_Comm communicator, std::vector<int> ranks);
+
+    /** @return rank of the process in 'mpiCommunicator' */
+    int toRank(ProcessId process) const;
+
+    ProcessId toProcessId(int rank) const;
+
+    /** All the MPI calls go through it, MPI_COMM_WORLD unless useCommunicator() has been called */
+    MPI_Comm mpiCommunicator = MPI_COMM_WORLD;
+    /** Both empty as long as the ranks are the process ids */
+    std::vector<int> ranksOfProcesses;
+    std::vector<ProcessId> processesOfRanks;
+
     MPI_Datatype mpiRawPacketType;
     std::recursive_mutex communicationMutex;
+    WaitStrategy waitStrategy = WaitStrategy::backingOff();
 };
 
 #endif //INC_3PC_MPISIMPLECOMMUNICATOR_H
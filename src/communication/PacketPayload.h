@@ -0,0 +1,139 @@
+#ifndef INC_3PC_PACKETPAYLOAD_H
+#define INC_3PC_PACKETPAYLOAD_H
+
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/** Payloads up to this size are stored inside the Packet itself */
+#define PACKET_INLINE_PAYLOAD_SIZE 24
+
+/**
+ * Bytes carried by a Packet. Small payloads (which is all of them on the token path) live inline without touching the
+ * heap, bigger ones (e.g. coalesced batches) fall back to a heap buffer which is reused by subsequent assignments.
+ */
+class PacketPayload {
+public:
+
+    PacketPayload() = default;
+
+    PacketPayload(std::string_view bytes) {
+        assign(bytes.data(), bytes.size());
+    }
+
+    PacketPayload(const std::string& bytes) : PacketPayload(std::string_view(bytes)) { }
+
+    PacketPayload(const PacketPayload& other) {
+        assign(other.data(), other.size());
+    }
+
+    PacketPayload(PacketPayload&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    PacketPayload& operator=(const PacketPayload& other) {
+        if (this != &other) {
+            assign(other.data(), other.size());
+        }
+        return *this;
+    }
+
+    PacketPayload& operator=(PacketPayload&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        if (other.length <= PACKET_INLINE_PAYLOAD_SIZE) {
+            std::memcpy(inlineBuffer, other.inlineBuffer, other.length);
+        }
+        heapBuffer = std::move(other.heapBuffer);
+        heapCapacity = other.heapCapacity;
+        length = other.length;
+        other.heapCapacity = 0;
+        other.length = 0;
+        return *this;
+    }
+
+    void assign(const char* bytes, std::size_t size) {
+        if (size > PACKET_INLINE_PAYLOAD_SIZE and size > heapCapacity) {
+            auto buffer = std::make_unique<char[]>(size);
+            std::memcpy(buffer.get(), bytes, size);
+            heapBuffer = std::move(buffer);
+            heapCapacity = size;
+            length = size;
+            return;
+        }
+        length = size;
+        if (size > 0) {
+            std::memmove(data(), bytes, size);
+        }
+    }
+
+    [[nodiscard]] const char* data() const {
+        return length > PACKET_INLINE_PAYLOAD_SIZE ? heapBuffer.get() : inlineBuffer;
+    }
+
+    char* data() {
+        return length > PACKET_INLINE_PAYLOAD_SIZE ? heapBuffer.get() : inlineBuffer;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return length;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return length == 0;
+    }
+
+    [[nodiscard]] std::string_view view() const {
+        return {data(), length};
+    }
+
+    operator std::string_view() const {
+        return view();
+    }
+
+    inline bool operator==(const PacketPayload& other) const {
+        return view() == other.view();
+    }
+
+    inline bool operator==(std::string_view other) const {
+        return view() == other;
+    }
+
+    inline bool operator!=(std::string_view other) const {
+        return view() != other;
+    }
+
+    /** Spelled out, as a std::string converts to both a PacketPayload and a std::string_view */
+    inline bool operator==(const std::string& other) const {
+        return view() == other;
+    }
+
+    inline bool operator!=(const std::string& other) const {
+        return view() != other;
+    }
+
+private:
+
+    std::size_t length = 0;
+    char inlineBuffer[PACKET_INLINE_PAYLOAD_SIZE];
+    std::unique_ptr<char[]> heapBuffer;
+    std::size_t heapCapacity = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const PacketPayload& payload) {
+    return os << payload.view();
+}
+
+namespace std {
+    template<>
+    struct hash<PacketPayload> {
+        inline std::size_t operator()(const PacketPayload& payload) const {
+            return std::hash<std::string_view>()(payload.view());
+        }
+    };
+}
+
+#endif //INC_3PC_PACKETPAYLOAD_H
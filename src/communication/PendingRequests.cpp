@@ -0,0 +1,85 @@
+#include <logging/Logger.h>
+#include <util/StringConcat.h>
+#include "PendingRequests.h"
+
+PendingRequests::~PendingRequests() {
+    {
+        std::lock_guard<std::mutex> lock(requestsMutex);
+        terminate = true;
+        deadlinesCond.notify_one();
+    }
+    if (timeoutThread) {
+        timeoutThread->join();
+    }
+}
+
+CorrelationId PendingRequests::add(ProcessId recipient, std::chrono::milliseconds timeout, std::future<Packet>& reply) {
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    const CorrelationId correlationId = correlationSeqNo++;
+    auto deadline = deadlines.emplace(std::chrono::steady_clock::now() + timeout, correlationId);
+    Request& request = requests.emplace(correlationId, Request {.reply = {}, .recipient = recipient,
+                                                                .deadline = deadline}).first->second;
+    reply = request.reply.get_future();
+
+    if (not timeoutThread) {
+        timeoutThread = std::make_unique<std::thread>([this, loggerContext = Logger::getContext()]() {
+            Logger::setContext(loggerContext);
+            timeoutThreadFunction();
+        });
+    } else if (deadline == deadlines.begin()) {
+        deadlinesCond.notify_one();
+    }
+    return correlationId;
+}
+
+bool PendingRequests::complete(Packet reply) {
+    std::unique_lock<std::mutex> lock(requestsMutex);
+    std::optional<Request> request = take(reply.correlationId);
+    lock.unlock();
+    if (not request) {
+        return false;
+    }
+    request->reply.set_value(std::move(reply));
+    return true;
+}
+
+void PendingRequests::fail(CorrelationId correlationId, std::exception_ptr error) {
+    std::unique_lock<std::mutex> lock(requestsMutex);
+    std::optional<Request> request = take(correlationId);
+    lock.unlock();
+    if (request) {
+        request->reply.set_exception(std::move(error));
+    }
+}
+
+std::optional<PendingRequests::Request> PendingRequests::take(CorrelationId correlationId) {
+    auto request = requests.find(correlationId);
+    if (request == requests.end()) {
+        return std::nullopt;
+    }
+    Request taken = std::move(request->second);
+    requests.erase(request);
+    deadlines.erase(taken.deadline);
+    return taken;
+}
+
+void PendingRequests::timeoutThreadFunction() {
+    Logger::registerThread("Reqs");
+    std::unique_lock<std::mutex> lock(requestsMutex);
+    while (not terminate) {
+        if (deadlines.empty()) {
+            deadlinesCond.wait(lock);
+            continue;
+        }
+        if (deadlines.begin()->first > std::chrono::steady_clock::now()) {
+            deadlinesCond.wait_until(lock, deadlines.begin()->first);
+            continue;
+        }
+        const CorrelationId correlationId = deadlines.begin()->second;
+        Request request = std::move(*take(correlationId));
+        lock.unlock();
+        request.reply.set_exception(std::make_exception_ptr(std::runtime_error(util::concat(
+                "Request #", correlationId, " to process ", request.recipient, " timed out"))));
+        lock.lock();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef INC_3PC_PENDINGREQUESTS_H
+#define INC_3PC_PENDINGREQUESTS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "ICommunicator.h"
+
+/**
+ * Requests which have been sent but not replied to yet, each with a promise to fulfil once its reply arrives. Requests
+ * which outlive their timeout are failed with a std::runtime_error by a thread started along with the first request.
+ */
+class PendingRequests {
+public:
+
+    ~PendingRequests();
+
+    /** @return id of the new request, which its reply has to carry */
+    CorrelationId add(ProcessId recipient, std::chrono::milliseconds timeout, std::future<Packet>& reply);
+
+    /** Fulfils the request the reply is correlated with. @return false if there is none, e.g. as it timed out */
+    bool complete(Packet reply);
+
+    /** Used when the request could not even be sent */
+    void fail(CorrelationId correlationId, std::exception_ptr error);
+
+protected:
+
+    using Deadlines = std::multimap<std::chrono::steady_clock::time_point, CorrelationId>;
+
+    struct Request {
+        std::promise<Packet> reply;
+        ProcessId recipient;
+        Deadlines::iterator deadline;
+    };
+
+    /** Has to be called with 'requestsMutex' held */
+    std::optional<Request> take(CorrelationId correlationId);
+
+    void timeoutThreadFunction();
+
+    std::unordered_map<CorrelationId, Request> requests;
+    Deadlines deadlines;
+    CorrelationId correlationSeqNo = 1;
+    bool terminate = false;
+
+    std::mutex requestsMutex;
+    std::condition_variable deadlinesCond;
+    std::unique_ptr<std::thread> timeoutThread;
+};
+
+#endif //INC_3PC_PENDINGREQUESTS_H
@@ -0,0 +1,49 @@
+#include "Rendezvous.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <util/WaitStrategy.h>
+
+Rendezvous::Rendezvous(std::string directory, ProcessId numberOfProcesses)
+        : directory(std::move(directory)), numberOfProcesses(numberOfProcesses) {
+}
+
+ProcessId Rendezvous::claimRank() {
+    for (ProcessId rank = 0; rank < numberOfProcesses; ++rank) {
+        int fd = open(getPath("claim", rank).c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        if (fd >= 0) {
+            close(fd);
+            return rank;
+        }
+        if (errno != EEXIST) {
+            throw std::runtime_error("Cannot claim a rank in '" + directory + "': " + std::strerror(errno));
+        }
+    }
+    throw std::runtime_error("All " + std::to_string(numberOfProcesses) + " ranks in '" + directory +
+                             "' have already been claimed");
+}
+
+std::string Rendezvous::getPath(const std::string& name, ProcessId process) const {
+    return directory + "/" + name + "-" + std::to_string(process);
+}
+
+void Rendezvous::waitForAll(const std::string& name) const {
+    ProcessId announced = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(RENDEZVOUS_TIMEOUT_SECONDS);
+    if (not WaitStrategy::backingOff().waitUntil(deadline, [&]() {
+        // Processes which have already been seen are not checked again
+        while (announced < numberOfProcesses and access(getPath(name, announced).c_str(), F_OK) == 0) {
+            ++announced;
+        }
+        return announced == numberOfProcesses;
+    })) {
+        throw std::runtime_error("Process " + std::to_string(announced) + " has not announced its '" + name +
+                                 "' in '" + directory + "'");
+    }
+}
+
+ProcessId Rendezvous::getNumberOfProcesses() const {
+    return numberOfProcesses;
+}
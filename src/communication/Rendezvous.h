@@ -0,0 +1,44 @@
+#ifndef INC_3PC_RENDEZVOUS_H
+#define INC_3PC_RENDEZVOUS_H
+
+#include <string>
+#include "ICommunicator.h"
+
+/** How long waitForAll() waits for the slowest process to show up */
+#define RENDEZVOUS_TIMEOUT_SECONDS 60
+
+/**
+ * Lets processes started independently (e.g. as separate services) agree on their ranks through a shared local
+ * directory. Every process claims the lowest rank whose claim file it manages to create exclusively, and then announces
+ * its resources by files named after its rank, which the other processes wait for. The directory should be fresh for
+ * every run, as claim files of a previous run would keep their ranks taken.
+ */
+class Rendezvous {
+public:
+
+    Rendezvous(std::string directory, ProcessId numberOfProcesses);
+
+    /**
+     * Claims the lowest free rank.
+     * @throws std::runtime_error if all the ranks have been claimed already
+     */
+    ProcessId claimRank();
+
+    /** @return path of the file by which the process announces the resource of the given name */
+    [[nodiscard]] std::string getPath(const std::string& name, ProcessId process) const;
+
+    /**
+     * Waits until every process has announced the resource of the given name.
+     * @throws std::runtime_error if that does not happen within RENDEZVOUS_TIMEOUT_SECONDS
+     */
+    void waitForAll(const std::string& name) const;
+
+    [[nodiscard]] ProcessId getNumberOfProcesses() const;
+
+private:
+
+    std::string directory;
+    ProcessId numberOfProcesses;
+};
+
+#endif //INC_3PC_RENDEZVOUS_H
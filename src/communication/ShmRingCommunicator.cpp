@@ -0,0 +1,268 @@
+#include "ShmRingCommunicator.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "MpiOptimizedCommunicator.h"
+
+namespace {
+    constexpr std::size_t slotHeaderSize = sizeof(EncodedNextPacketLength) + sizeof(ShmTag);
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free and std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared memory rings need address-free atomics");
+
+    /** Every sending thread encodes into its own buffer, so steady-state sends do not allocate */
+    thread_local char sendBuffer[SHM_SLOT_SIZE];
+
+    void futexWait(std::atomic<uint32_t>& word, uint32_t expected, const timespec* timeout) {
+        // Not FUTEX_PRIVATE, as the word is shared with other processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+    }
+
+    void futexWake(std::atomic<uint32_t>& word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    int checked(int result, const char* operation) {
+        if (result < 0) {
+            throw std::runtime_error(std::string(operation) + " failed: " + std::strerror(errno));
+        }
+        return result;
+    }
+}
+
+ShmSegmentHeader& ShmRingCommunicator::Segment::header() const {
+    return *static_cast<ShmSegmentHeader*>(address);
+}
+
+ShmRing& ShmRingCommunicator::Segment::ring(ProcessId source) const {
+    auto* rings = reinterpret_cast<ShmRing*>(static_cast<char*>(address) + sizeof(ShmSegmentHeader));
+    return rings[source];
+}
+
+ShmRingCommunicator::ShmRingCommunicator(const std::string& rendezvousDirectory, ProcessId numberOfProcesses)
+        : rendezvous(rendezvousDirectory, numberOfProcesses) {
+    this->numberOfProcesses = numberOfProcesses;
+    myProcessId = rendezvous.claimRank();
+    segmentPath = rendezvous.getPath("segment", myProcessId);
+
+    // The segment only appears under its final name once it is initialized
+    const std::string creationPath = segmentPath + ".creating";
+    inbound = mapSegment(creationPath, true);
+    new (&inbound.header()) ShmSegmentHeader {};
+    for (ProcessId source = 0; source < numberOfProcesses; ++source) {
+        new (&inbound.ring(source)) ShmRing {};
+    }
+    checked(rename(creationPath.c_str(), segmentPath.c_str()), "rename");
+
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        links.push_back(std::make_unique<Link>());
+        if (id != myProcessId) {
+            otherProcesses.insert(id);
+        }
+    }
+    rendezvous.waitForAll("segment");
+}
+
+ShmRingCommunicator::~ShmRingCommunicator() {
+    for (auto& link : links) {
+        if (link->segment.address) {
+            munmap(link->segment.address, link->segment.size);
+        }
+    }
+    munmap(inbound.address, inbound.size);
+    unlink(segmentPath.c_str());
+}
+
+Packet ShmRingCommunicator::send(MessageType messageType, const std::string& message,
+                                 const std::unordered_set<ProcessId>& recipients, ShmTag tag) {
+    std::vector<ProcessId> recipientList(recipients.begin(), recipients.end());
+    return Packet {
+            .lamportTime = post(messageType, message, recipientList.data(), recipientList.size(), tag),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+LamportTime ShmRingCommunicator::post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                      std::size_t numberOfRecipients, ShmTag tag) {
+    const std::size_t frameSize = slotHeaderSize + MpiOptimizedCommunicator::getFrameSize(message);
+    if (frameSize > SHM_SLOT_SIZE) {
+        throw std::length_error("Frame of " + std::to_string(frameSize) + " bytes exceeds the slot size of " +
+                                std::to_string(SHM_SLOT_SIZE) + " bytes");
+    }
+    const auto length = static_cast<EncodedNextPacketLength>(frameSize - slotHeaderSize);
+    std::memcpy(sendBuffer, &length, sizeof(length));
+    std::memcpy(sendBuffer + sizeof(length), &tag, sizeof(tag));
+
+    // The rings have a single producer, so threads of this process take turns on them
+    if (numberOfRecipients == 1) {
+        std::lock_guard<std::mutex> lock(links.at(static_cast<unsigned long>(recipients[0]))->mutex);
+        return stampAndEnqueue(messageType, message, recipients, numberOfRecipients, frameSize);
+    }
+    // Locked in the order of the process ids, so that concurrent broadcasts do not deadlock
+    std::vector<ProcessId> sortedRecipients(recipients, recipients + numberOfRecipients);
+    std::sort(sortedRecipients.begin(), sortedRecipients.end());
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (ProcessId recipient : sortedRecipients) {
+        locks.emplace_back(links.at(static_cast<unsigned long>(recipient))->mutex);
+    }
+    return stampAndEnqueue(messageType, message, recipients, numberOfRecipients, frameSize);
+}
+
+LamportTime ShmRingCommunicator::stampAndEnqueue(MessageType messageType, std::string_view message,
+                                                 const ProcessId* recipients, std::size_t numberOfRecipients,
+                                                 std::size_t frameSize) {
+    const LamportTime lamportTime = tickLamportTime();
+    MpiOptimizedCommunicator::encode(sendBuffer + slotHeaderSize, lamportTime, messageType, message);
+    for (std::size_t i = 0; i < numberOfRecipients; ++i) {
+        Link& link = *links.at(static_cast<unsigned long>(recipients[i]));
+        if (not link.segment.address) {
+            link.segment = mapSegment(rendezvous.getPath("segment", recipients[i]), false);
+        }
+        enqueue(link.segment, sendBuffer, frameSize);
+    }
+    return lamportTime;
+}
+
+void ShmRingCommunicator::enqueue(const Segment& segment, const char* frame, std::size_t frameSize) {
+    ShmRing& ring = segment.ring(myProcessId);
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    // A full ring only drains as fast as the receiver processes the packets, so there is no point in spinning hard
+    WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+        return head - ring.tail.load(std::memory_order_acquire) < SHM_RING_SLOTS;
+    });
+    std::memcpy(ring.slots[head % SHM_RING_SLOTS], frame, frameSize);
+    ring.head.store(head + 1, std::memory_order_release);
+
+    // Pairs with the fence of the receiver going to sleep - either it sees the frame or the sender sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ShmSegmentHeader& header = segment.header();
+    if (header.consumerSleeping.load(std::memory_order_relaxed)) {
+        header.doorbell.fetch_add(1, std::memory_order_release);
+        futexWake(header.doorbell);
+    }
+}
+
+Packet ShmRingCommunicator::receive(ShmTag tag) {
+    while (true) {
+        if (std::optional<Packet> packet = takeReceived(tag)) {
+            return std::move(*packet);
+        }
+        waitForFrames(std::chrono::steady_clock::time_point::max());
+    }
+}
+
+std::optional<Packet> ShmRingCommunicator::receive(long timeoutMillis, ShmTag tag) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    while (true) {
+        if (std::optional<Packet> packet = takeReceived(tag)) {
+            return packet;
+        }
+        if (not waitForFrames(deadline)) {
+            return std::nullopt;
+        }
+    }
+}
+
+Packet ShmRingCommunicator::receive() {
+    return receive(SHM_ANY_TAG);
+}
+
+std::optional<Packet> ShmRingCommunicator::receive(long timeoutMillis) {
+    return receive(timeoutMillis, SHM_ANY_TAG);
+}
+
+ShmTag ShmRingCommunicator::getDefaultTag() const {
+    return SHM_DEFAULT_TAG;
+}
+
+std::size_t ShmRingCommunicator::getSegmentSize() const {
+    return sizeof(ShmSegmentHeader) + static_cast<std::size_t>(numberOfProcesses) * sizeof(ShmRing);
+}
+
+ShmRingCommunicator::Segment ShmRingCommunicator::mapSegment(const std::string& path, bool create) const {
+    int fd = checked(open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDWR | O_CLOEXEC, 0600),
+                     "open");
+    Segment segment {.address = nullptr, .size = getSegmentSize()};
+    if (create and ftruncate(fd, static_cast<off_t>(segment.size)) < 0) {
+        close(fd);
+        checked(-1, "ftruncate");
+    }
+    segment.address = mmap(nullptr, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment.address == MAP_FAILED) {
+        checked(-1, "mmap");
+    }
+    return segment;
+}
+
+bool ShmRingCommunicator::drainRings() {
+    bool drained = false;
+    for (ProcessId source = 0; source < numberOfProcesses; ++source) {
+        ShmRing& ring = inbound.ring(source);
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring.head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const char* slot = ring.slots[tail % SHM_RING_SLOTS];
+            EncodedNextPacketLength length;
+            ShmTag tag;
+            std::memcpy(&length, slot, sizeof(length));
+            std::memcpy(&tag, slot + sizeof(length), sizeof(tag));
+            ReceivedPacket& received = receivedPackets.emplace_back(ReceivedPacket {.tag = tag, .packet = {}});
+            MpiOptimizedCommunicator::decode(slot + slotHeaderSize, length, source, received.packet);
+            drained = true;
+        }
+        // The frames have been copied out, so the slots can go back to the sender
+        ring.tail.store(tail, std::memory_order_release);
+    }
+    return drained;
+}
+
+bool ShmRingCommunicator::waitForFrames(std::chrono::steady_clock::time_point deadline) {
+    using namespace std::chrono;
+    auto spinDeadline = std::min(deadline, steady_clock::now() + microseconds(SHM_SPIN_MICROS));
+    if (WaitStrategy::spinning().waitUntil(spinDeadline, [&]() { return drainRings(); })) {
+        return true;
+    }
+    ShmSegmentHeader& header = inbound.header();
+    while (true) {
+        const uint32_t doorbell = header.doorbell.load(std::memory_order_acquire);
+        header.consumerSleeping.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool arrived = drainRings();
+        auto now = steady_clock::now();
+        if (arrived or now >= deadline) {
+            header.consumerSleeping.store(0, std::memory_order_relaxed);
+            return arrived;
+        }
+        if (deadline == steady_clock::time_point::max()) {
+            futexWait(header.doorbell, doorbell, nullptr);
+        } else {
+            auto remaining = duration_cast<nanoseconds>(deadline - now).count();
+            timespec timeout {.tv_sec = remaining / 1000000000, .tv_nsec = remaining % 1000000000};
+            futexWait(header.doorbell, doorbell, &timeout);
+        }
+        header.consumerSleeping.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::optional<Packet> ShmRingCommunicator::takeReceived(ShmTag tag) {
+    for (auto received = receivedPackets.begin(); received != receivedPackets.end(); ++received) {
+        if (tag == SHM_ANY_TAG or received->tag == tag) {
+            Packet packet = std::move(received->packet);
+            receivedPackets.erase(received);
+            packet.lamportTime = mergeLamportTime(packet.lamportTime);
+            return packet;
+        }
+    }
+    return std::nullopt;
+}
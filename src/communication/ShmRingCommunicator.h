@@ -0,0 +1,137 @@
+#ifndef INC_3PC_SHMRINGCOMMUNICATOR_H
+#define INC_3PC_SHMRINGCOMMUNICATOR_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <util/WaitStrategy.h>
+#include "ITaggedCommunicator.h"
+#include "Rendezvous.h"
+
+#define SHM_DEFAULT_TAG 0
+#define SHM_ANY_TAG (-1)
+/** Number of frames a single link is able to hold before the sender has to wait */
+#define SHM_RING_SLOTS 64
+/** Size of a single slot, including the length and tag prefix of the frame */
+#define SHM_SLOT_SIZE 128
+/** How long an idle receiver keeps polling the rings before it goes to sleep on the futex */
+#define SHM_SPIN_MICROS 50
+
+using ShmTag = int32_t;
+
+/** Single-producer single-consumer ring carrying the frames of one directed link, lives in shared memory */
+struct ShmRing {
+    /** Index of the next slot the producer is going to fill, only ever written by the producer */
+    alignas(64) std::atomic<uint64_t> head;
+    /** Index of the next slot the consumer is going to take, only ever written by the consumer */
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) char slots[SHM_RING_SLOTS][SHM_SLOT_SIZE];
+};
+
+/** Beginning of the segment of every process, followed by one ShmRing per sending process */
+struct ShmSegmentHeader {
+    /** Futex word bumped by the producers to wake the consumer up */
+    alignas(64) std::atomic<uint32_t> doorbell;
+    std::atomic<uint32_t> consumerSleeping;
+};
+
+/**
+ * Communicator for processes running on the same machine which bypasses MPI and the kernel altogether. Every process
+ * owns a shared memory segment holding one ShmRing per sending process, so every directed link has a lock-free
+ * SPSC ring of its own (threads of the sending process take turns on it under a local mutex). The receiver polls its
+ * rings for a while and then sleeps on a futex, which the senders only ring when they see it sleeping.
+ *
+ * Processes find each other through a Rendezvous directory, which also holds the segments, so it should reside on
+ * a tmpfs (e.g. under /dev/shm). A slot of the ring is laid out as
+ * [EncodedNextPacketLength length][ShmTag tag][frame encoded by MpiOptimizedCommunicator::encode], so frames have to
+ * fit into SHM_SLOT_SIZE bytes.
+ */
+class ShmRingCommunicator : public ITaggedCommunicator<ShmTag> {
+public:
+
+    ShmRingCommunicator(const std::string& rendezvousDirectory, ProcessId numberOfProcesses);
+
+    ~ShmRingCommunicator();
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, ShmTag tag) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients, ShmTag tag) override;
+
+    using ITaggedCommunicator<ShmTag>::send;
+
+    using ITaggedCommunicator<ShmTag>::post;
+
+    Packet receive(ShmTag tag) override;
+
+    std::optional<Packet> receive(long timeoutMillis, ShmTag tag) override;
+
+    Packet receive() override;
+
+    std::optional<Packet> receive(long timeoutMillis) override;
+
+    ShmTag getDefaultTag() const override;
+
+protected:
+
+    /** Mapping of the segment of a process */
+    struct Segment {
+        void* address = nullptr;
+        std::size_t size = 0;
+
+        ShmSegmentHeader& header() const;
+
+        ShmRing& ring(ProcessId source) const;
+    };
+
+    /** Outgoing side of a link, the segment of the recipient is mapped when it is first sent to */
+    struct Link {
+        std::mutex mutex;
+        Segment segment;
+    };
+
+    struct ReceivedPacket {
+        ShmTag tag;
+        Packet packet;
+    };
+
+    std::size_t getSegmentSize() const;
+
+    Segment mapSegment(const std::string& path, bool create) const;
+
+    /**
+     * Stamps the frame waiting in the send buffer and enqueues it for the recipients. Has to be called with the
+     * mutexes of all their links held, so that a frame stamped later never gets ahead of an earlier one on a link.
+     */
+    LamportTime stampAndEnqueue(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                std::size_t numberOfRecipients, std::size_t frameSize);
+
+    /** Has to be called with the mutex of the link held */
+    void enqueue(const Segment& segment, const char* frame, std::size_t frameSize);
+
+    /** Moves every frame waiting in the rings into 'receivedPackets'. @return whether there was any */
+    bool drainRings();
+
+    /**
+     * Polls the rings and then sleeps until a sender rings the doorbell.
+     * @return false if nothing has arrived before the deadline
+     */
+    bool waitForFrames(std::chrono::steady_clock::time_point deadline);
+
+    /** Takes out the oldest received packet with a matching tag, if there is any */
+    std::optional<Packet> takeReceived(ShmTag tag);
+
+    Rendezvous rendezvous;
+    std::string segmentPath;
+    Segment inbound;
+
+    /** Indexed by the recipient */
+    std::vector<std::unique_ptr<Link>> links;
+
+    /** Only touched by the receiving thread */
+    std::deque<ReceivedPacket> receivedPackets;
+};
+
+#endif //INC_3PC_SHMRINGCOMMUNICATOR_H
@@ -0,0 +1,314 @@
+#include "SocketCommunicator.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <logging/Logger.h>
+#include <util/StringConcat.h>
+#include "MpiOptimizedCommunicator.h"
+
+namespace {
+    constexpr std::size_t frameHeaderSize = sizeof(EncodedNextPacketLength) + sizeof(SocketTag);
+    constexpr std::size_t readChunkSize = 4096;
+    /** The length of a frame covers its tag and the header of the encoded packet at the very least */
+    const std::size_t minFrameLength = sizeof(SocketTag) + MpiOptimizedCommunicator::getFrameSize({});
+    constexpr std::size_t maxFrameLength = SOCKET_MAX_FRAME_SIZE - sizeof(EncodedNextPacketLength);
+
+    /** Every sending thread encodes into its own buffer, which only ever grows, so steady-state sends do not allocate */
+    thread_local std::string sendBuffer;
+
+    int checked(int result, const char* operation) {
+        if (result < 0) {
+            throw std::runtime_error(std::string(operation) + " failed: " + std::strerror(errno));
+        }
+        return result;
+    }
+
+    sockaddr_un toAddress(const std::string& path) {
+        sockaddr_un address {};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::length_error("Socket path '" + path + "' is too long");
+        }
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        return address;
+    }
+}
+
+SocketCommunicator::SocketCommunicator(const std::string& rendezvousDirectory, ProcessId numberOfProcesses)
+        : rendezvous(rendezvousDirectory, numberOfProcesses) {
+    this->numberOfProcesses = numberOfProcesses;
+    myProcessId = rendezvous.claimRank();
+    socketPath = rendezvous.getPath("socket", myProcessId);
+
+    // The socket only appears under its final name once it is listening, so that nobody connects too early
+    const std::string bindingPath = socketPath + ".binding";
+    const sockaddr_un address = toAddress(bindingPath);
+    listeningFd = checked(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket");
+    unlink(bindingPath.c_str());
+    checked(bind(listeningFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), "bind");
+    checked(listen(listeningFd, numberOfProcesses), "listen");
+    checked(rename(bindingPath.c_str(), socketPath.c_str()), "rename");
+
+    epollFd = checked(epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+    epoll_event event {.events = EPOLLIN, .data = {.fd = listeningFd}};
+    checked(epoll_ctl(epollFd, EPOLL_CTL_ADD, listeningFd, &event), "epoll_ctl");
+
+    for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+        links.push_back(std::make_unique<Link>());
+        if (id != myProcessId) {
+            otherProcesses.insert(id);
+        }
+    }
+    rendezvous.waitForAll("socket");
+}
+
+SocketCommunicator::~SocketCommunicator() {
+    for (auto& link : links) {
+        if (link->fd >= 0) {
+            close(link->fd);
+        }
+    }
+    for (auto& [fd, connection] : connections) {
+        close(fd);
+    }
+    close(epollFd);
+    close(listeningFd);
+    unlink(socketPath.c_str());
+}
+
+Packet SocketCommunicator::send(MessageType messageType, const std::string& message,
+                                const std::unordered_set<ProcessId>& recipients, SocketTag tag) {
+    std::vector<ProcessId> recipientList(recipients.begin(), recipients.end());
+    return Packet {
+            .lamportTime = post(messageType, message, recipientList.data(), recipientList.size(), tag),
+            .source = myProcessId,
+            .messageType = messageType,
+            .message = message
+    };
+}
+
+LamportTime SocketCommunicator::post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                                     std::size_t numberOfRecipients, SocketTag tag) {
+    const std::size_t frameSize = frameHeaderSize + MpiOptimizedCommunicator::getFrameSize(message);
+    if (frameSize > SOCKET_MAX_FRAME_SIZE) {
+        throw std::length_error(util::concat("Frame of ", frameSize, " bytes exceeds SOCKET_MAX_FRAME_SIZE"));
+    }
+    if (sendBuffer.size() < frameSize) {
+        sendBuffer.resize(frameSize);
+    }
+    const auto length = static_cast<EncodedNextPacketLength>(frameSize - sizeof(EncodedNextPacketLength));
+    std::memcpy(sendBuffer.data(), &length, sizeof(length));
+    std::memcpy(sendBuffer.data() + sizeof(length), &tag, sizeof(tag));
+
+    // Holding the locks of the links for the whole write keeps frames of concurrent senders from interleaving
+    if (numberOfRecipients == 1) {
+        std::lock_guard<std::mutex> lock(links.at(static_cast<unsigned long>(recipients[0]))->mutex);
+        return stampAndWrite(messageType, message, recipients, numberOfRecipients, frameSize);
+    }
+    // Locked in the order of the process ids, so that concurrent broadcasts do not deadlock
+    std::vector<ProcessId> sortedRecipients(recipients, recipients + numberOfRecipients);
+    std::sort(sortedRecipients.begin(), sortedRecipients.end());
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (ProcessId recipient : sortedRecipients) {
+        locks.emplace_back(links.at(static_cast<unsigned long>(recipient))->mutex);
+    }
+    return stampAndWrite(messageType, message, recipients, numberOfRecipients, frameSize);
+}
+
+LamportTime SocketCommunicator::stampAndWrite(MessageType messageType, std::string_view message,
+                                              const ProcessId* recipients, std::size_t numberOfRecipients,
+                                              std::size_t frameSize) {
+    const LamportTime lamportTime = tickLamportTime();
+    MpiOptimizedCommunicator::encode(sendBuffer.data() + frameHeaderSize, lamportTime, messageType, message);
+    for (std::size_t i = 0; i < numberOfRecipients; ++i) {
+        Link& link = *links.at(static_cast<unsigned long>(recipients[i]));
+        if (link.fd < 0) {
+            connectTo(recipients[i], link);
+        }
+        writeAll(link.fd, sendBuffer.data(), frameSize);
+    }
+    return lamportTime;
+}
+
+Packet SocketCommunicator::receive(SocketTag tag) {
+    while (true) {
+        if (std::optional<Packet> packet = takeReceived(tag)) {
+            return std::move(*packet);
+        }
+        pollConnections(-1);
+    }
+}
+
+std::optional<Packet> SocketCommunicator::receive(long timeoutMillis, SocketTag tag) {
+    using namespace std::chrono;
+    auto deadline = steady_clock::now() + milliseconds(timeoutMillis);
+    while (true) {
+        if (std::optional<Packet> packet = takeReceived(tag)) {
+            return packet;
+        }
+        auto remaining = ceil<milliseconds>(deadline - steady_clock::now());
+        if (remaining.count() < 0) {
+            return std::nullopt;
+        }
+        pollConnections(static_cast<int>(remaining.count()));
+    }
+}
+
+Packet SocketCommunicator::receive() {
+    return receive(SOCKET_ANY_TAG);
+}
+
+std::optional<Packet> SocketCommunicator::receive(long timeoutMillis) {
+    return receive(timeoutMillis, SOCKET_ANY_TAG);
+}
+
+SocketTag SocketCommunicator::getDefaultTag() const {
+    return SOCKET_DEFAULT_TAG;
+}
+
+void SocketCommunicator::connectTo(ProcessId recipient, Link& link) {
+    const sockaddr_un address = toAddress(rendezvous.getPath("socket", recipient));
+    int fd = checked(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        checked(-1, "connect");
+    }
+    // The first thing on every link is the id of the connecting process
+    const auto source = static_cast<EncodedProcessId>(myProcessId);
+    writeAll(fd, reinterpret_cast<const char*>(&source), sizeof(source));
+    link.fd = fd;
+}
+
+void SocketCommunicator::pollConnections(int timeoutMillis) {
+    epoll_event events[SOCKET_MAX_EVENTS];
+    int numberOfEvents = epoll_wait(epollFd, events, SOCKET_MAX_EVENTS, timeoutMillis);
+    if (numberOfEvents < 0 and errno == EINTR) {
+        return;
+    }
+    checked(numberOfEvents, "epoll_wait");
+
+    for (int i = 0; i < numberOfEvents; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == listeningFd) {
+            acceptConnections();
+            continue;
+        }
+        auto connection = connections.find(fd);
+        if (not readConnection(fd, connection->second)) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            connections.erase(connection);
+        }
+    }
+}
+
+void SocketCommunicator::acceptConnections() {
+    while (true) {
+        int fd = accept4(listeningFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN or errno == EWOULDBLOCK) {
+                return;
+            }
+            checked(fd, "accept4");
+        }
+        epoll_event event {.events = EPOLLIN, .data = {.fd = fd}};
+        checked(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event), "epoll_ctl");
+        connections.emplace(fd, Connection {});
+    }
+}
+
+bool SocketCommunicator::readConnection(int fd, Connection& connection) {
+    std::string& buffer = connection.buffer;
+    while (true) {
+        const std::size_t offset = buffer.size();
+        buffer.resize(offset + readChunkSize);
+        ssize_t bytesRead = read(fd, buffer.data() + offset, readChunkSize);
+        buffer.resize(offset + static_cast<std::size_t>(std::max<ssize_t>(bytesRead, 0)));
+        if (bytesRead > 0) {
+            continue;
+        }
+        if (bytesRead < 0 and errno == EINTR) {
+            continue;
+        }
+        if (not extractFrames(connection)) {
+            return false;
+        }
+        if (bytesRead == 0) {
+            return false;
+        }
+        if (errno == EAGAIN or errno == EWOULDBLOCK) {
+            return true;
+        }
+        checked(-1, "read");
+    }
+}
+
+bool SocketCommunicator::extractFrames(Connection& connection) {
+    const std::string& buffer = connection.buffer;
+    std::size_t offset = 0;
+    if (connection.source < 0) {
+        EncodedProcessId source;
+        if (buffer.size() < sizeof(source)) {
+            return true;
+        }
+        std::memcpy(&source, buffer.data(), sizeof(source));
+        connection.source = static_cast<ProcessId>(source);
+        offset += sizeof(source);
+    }
+    while (buffer.size() - offset >= sizeof(EncodedNextPacketLength)) {
+        EncodedNextPacketLength length;
+        std::memcpy(&length, buffer.data() + offset, sizeof(length));
+        if (length < minFrameLength or length > maxFrameLength) {
+            Logger::log<LogLevel::ERROR>([&]() {
+                return util::concat("Frame of ", length, " bytes from process ", connection.source,
+                                    " is malformed - closing the connection");
+            });
+            return false;
+        }
+        if (buffer.size() - offset - sizeof(length) < length) {
+            break;
+        }
+        const char* frame = buffer.data() + offset + sizeof(length);
+        SocketTag tag;
+        std::memcpy(&tag, frame, sizeof(tag));
+        ReceivedPacket& received = receivedPackets.emplace_back(ReceivedPacket {.tag = tag, .packet = {}});
+        MpiOptimizedCommunicator::decode(frame + sizeof(tag), length - sizeof(tag), connection.source, received.packet);
+        offset += sizeof(length) + length;
+    }
+    connection.buffer.erase(0, offset);
+    return true;
+}
+
+std::optional<Packet> SocketCommunicator::takeReceived(SocketTag tag) {
+    for (auto received = receivedPackets.begin(); received != receivedPackets.end(); ++received) {
+        if (tag == SOCKET_ANY_TAG or received->tag == tag) {
+            Packet packet = std::move(received->packet);
+            receivedPackets.erase(received);
+            packet.lamportTime = mergeLamportTime(packet.lamportTime);
+            return packet;
+        }
+    }
+    return std::nullopt;
+}
+
+void SocketCommunicator::writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t bytesWritten = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (bytesWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            checked(-1, "send");
+        }
+        data += bytesWritten;
+        size -= static_cast<std::size_t>(bytesWritten);
+    }
+}
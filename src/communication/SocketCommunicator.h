@@ -0,0 +1,120 @@
+#ifndef INC_3PC_SOCKETCOMMUNICATOR_H
+#define INC_3PC_SOCKETCOMMUNICATOR_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "ITaggedCommunicator.h"
+#include "Rendezvous.h"
+
+#define SOCKET_DEFAULT_TAG 0
+#define SOCKET_ANY_TAG (-1)
+/** Maximal number of events taken from epoll at once */
+#define SOCKET_MAX_EVENTS 16
+/** Maximal size of a frame on the wire, a peer announcing a longer one is cut off instead of being buffered for */
+#define SOCKET_MAX_FRAME_SIZE (16 << 20)
+
+using SocketTag = int32_t;
+
+/**
+ * Communicator over Unix domain stream sockets, which needs no MPI launcher - processes find each other through a
+ * Rendezvous directory. Every process listens on its own socket and lazily connects to the processes it sends to, so
+ * every link carries a single direction. A frame on the wire is laid out as:
+ * [EncodedNextPacketLength length][SocketTag tag][frame encoded by MpiOptimizedCommunicator::encode],
+ * where the length covers both the tag and the encoded frame.
+ *
+ * Incoming connections are served by an epoll event loop run by the receiving thread itself, so receiving needs no
+ * additional thread. Just like with MPI, only a single thread may receive at a time.
+ */
+class SocketCommunicator : public ITaggedCommunicator<SocketTag> {
+public:
+
+    SocketCommunicator(const std::string& rendezvousDirectory, ProcessId numberOfProcesses);
+
+    ~SocketCommunicator();
+
+    Packet send(MessageType messageType, const std::string& message, const std::unordered_set<ProcessId>& recipients, SocketTag tag) override;
+
+    LamportTime post(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                     std::size_t numberOfRecipients, SocketTag tag) override;
+
+    using ITaggedCommunicator<SocketTag>::send;
+
+    using ITaggedCommunicator<SocketTag>::post;
+
+    Packet receive(SocketTag tag) override;
+
+    std::optional<Packet> receive(long timeoutMillis, SocketTag tag) override;
+
+    Packet receive() override;
+
+    std::optional<Packet> receive(long timeoutMillis) override;
+
+    SocketTag getDefaultTag() const override;
+
+protected:
+
+    /** Outgoing connection to a single process */
+    struct Link {
+        std::mutex mutex;
+        int fd = -1;
+    };
+
+    /** Incoming connection from a single process */
+    struct Connection {
+        /** Unknown until the connecting process introduces itself */
+        ProcessId source = -1;
+        std::string buffer;
+    };
+
+    struct ReceivedPacket {
+        SocketTag tag;
+        Packet packet;
+    };
+
+    /** Has to be called with the mutex of the link held */
+    void connectTo(ProcessId recipient, Link& link);
+
+    /**
+     * Stamps the frame waiting in the send buffer and writes it to the recipients. Has to be called with the mutexes
+     * of all their links held, so that a frame stamped later never gets ahead of an earlier one on the same link.
+     */
+    LamportTime stampAndWrite(MessageType messageType, std::string_view message, const ProcessId* recipients,
+                              std::size_t numberOfRecipients, std::size_t frameSize);
+
+    /** Waits for the sockets to become readable and takes in everything that has arrived so far */
+    void pollConnections(int timeoutMillis);
+
+    void acceptConnections();
+
+    /** @return false once the peer has closed the connection or has broken the framing */
+    bool readConnection(int fd, Connection& connection);
+
+    /**
+     * Moves the complete frames out of the buffer of the connection into 'receivedPackets'
+     * @return false if the peer has sent a frame whose length is too short to hold the headers or longer than
+     * SOCKET_MAX_FRAME_SIZE, after which nothing on the connection can be trusted
+     */
+    bool extractFrames(Connection& connection);
+
+    /** Takes out the oldest received packet with a matching tag, if there is any */
+    std::optional<Packet> takeReceived(SocketTag tag);
+
+    static void writeAll(int fd, const char* data, std::size_t size);
+
+    Rendezvous rendezvous;
+    std::string socketPath;
+    int listeningFd = -1;
+    int epollFd = -1;
+
+    /** Indexed by the recipient */
+    std::vector<std::unique_ptr<Link>> links;
+
+    /** Only touched by the receiving thread */
+    std::unordered_map<int, Connection> connections;
+    std::deque<ReceivedPacket> receivedPackets;
+};
+
+#endif //INC_3PC_SOCKETCOMMUNICATOR_H
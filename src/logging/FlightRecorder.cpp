@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <semaphore.h>
+#include <thread>
+#include <util/StringConcat.h>
+#include "FlightRecorder.h"
+
+std::mutex FlightRecorder::mutex;
+std::vector<FlightRecorder::Ring*> FlightRecorder::rings;
+thread_local FlightRecorder::Ring* FlightRecorder::ring = nullptr;
+thread_local std::string FlightRecorder::threadName;
+std::atomic<ProcessId> FlightRecorder::rank = 0;
+std::string FlightRecorder::directory = ".";
+std::once_flag FlightRecorder::handlersInstalled;
+
+namespace {
+    /** Posted by the SIGUSR1 handler, sem_post being one of the few things a signal handler may call */
+    sem_t dumpRequests;
+
+    std::terminate_handler previousTerminateHandler;
+
+    /** The coarse clock is read without a system call and at a fraction of the cost of the precise one */
+    int64_t getCoarseWallTimeNanos() {
+        timespec time {};
+        clock_gettime(CLOCK_REALTIME_COARSE, &time);
+        return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+}
+
+
+void FlightRecorder::init(ProcessId rank, const std::string& directory) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        FlightRecorder::directory = directory;
+        FlightRecorder::rank = rank;
+    }
+    std::call_once(handlersInstalled, []() {
+        sem_init(&dumpRequests, 0, 0);
+        std::thread(dumpingThreadFunction).detach();
+
+        struct sigaction action {};
+        action.sa_handler = [](int) { sem_post(&dumpRequests); };
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, nullptr);
+
+        previousTerminateHandler = std::set_terminate([]() {
+            dump("terminate");
+            previousTerminateHandler ? previousTerminateHandler() : std::abort();
+        });
+    });
+}
+
+void FlightRecorder::record(TraceEvent event, ProcessId processId, LamportTime lamportTime, int64_t argument0,
+                            int64_t argument1) {
+    Ring& ring = getRing();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[head % FLIGHT_RECORDER_EVENTS];
+    // Pairs with the acquire fence of dump(): a dump which reads any of the new fields also reads the head stored by
+    // the previous record, which tells it that the old event of the slot is being overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.wallTimeNanos.store(getCoarseWallTimeNanos(), std::memory_order_relaxed);
+    slot.lamportTime.store(lamportTime, std::memory_order_relaxed);
+    slot.eventAndProcess.store(static_cast<int64_t>(event) | static_cast<int64_t>(processId) << 16,
+                               std::memory_order_relaxed);
+    slot.arguments[0].store(argument0, std::memory_order_relaxed);
+    slot.arguments[1].store(argument1, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder::setThreadName(const std::string& name) {
+    threadName = name;
+    // Threads which never record anything do not get a ring at all
+    if (ring) {
+        std::lock_guard<std::mutex> guard(mutex);
+        copyThreadName(*ring);
+    }
+}
+
+void FlightRecorder::dump(const std::string& reason) {
+    std::lock_guard<std::mutex> guard(mutex);
+    std::vector<Event> events;
+    for (const auto& ring : rings) {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t first = head > FLIGHT_RECORDER_EVENTS ? head - FLIGHT_RECORDER_EVENTS : 0;
+        const std::size_t firstCopied = events.size();
+        for (uint64_t index = first; index < head; ++index) {
+            const Slot& slot = ring->slots[index % FLIGHT_RECORDER_EVENTS];
+            const int64_t eventAndProcess = slot.eventAndProcess.load(std::memory_order_relaxed);
+            events.push_back(Event {
+                    .wallTimeNanos = slot.wallTimeNanos.load(std::memory_order_relaxed),
+                    .lamportTime = slot.lamportTime.load(std::memory_order_relaxed),
+                    .processId = static_cast<ProcessId>(eventAndProcess >> 16),
+                    .event = static_cast<TraceEvent>(eventAndProcess & 0xffff),
+                    .arguments = {slot.arguments[0].load(std::memory_order_relaxed),
+                                  slot.arguments[1].load(std::memory_order_relaxed)},
+                    .threadName = ring->threadName
+            });
+        }
+        // The thread keeps recording, so the oldest slots may have been overwritten (or be just written) meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t headAfterwards = ring->head.load(std::memory_order_relaxed);
+        const uint64_t firstIntact = headAfterwards + 1 > FLIGHT_RECORDER_EVENTS ?
+                                     headAfterwards + 1 - FLIGHT_RECORDER_EVENTS : 0;
+        if (firstIntact > first) {
+            const auto overwritten = static_cast<std::ptrdiff_t>(std::min(firstIntact, head) - first);
+            events.erase(events.begin() + static_cast<std::ptrdiff_t>(firstCopied),
+                         events.begin() + static_cast<std::ptrdiff_t>(firstCopied) + overwritten);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event& first, const Event& second) {
+        return first.lamportTime < second.lamportTime;
+    });
+
+    std::ofstream file(util::concat(directory, "/flight-", rank.load(), ".log"), std::ios::app);
+    const std::time_t now = std::time(nullptr);
+    std::tm tm {};
+    localtime_r(&now, &tm);
+    file << "----- Flight recorder dump (" << reason << ") at " << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ", "
+         << events.size() << " events -----\n";
+    for (const Event& event : events) {
+        const std::time_t seconds = event.wallTimeNanos / 1000000000;
+        localtime_r(&seconds, &tm);
+        file << "[TS " << std::setw(8) << std::setfill('0') << event.lamportTime << " "
+             << std::put_time(&tm, "%H:%M:%S") << "." << std::setw(3) << event.wallTimeNanos % 1000000000 / 1000000
+             << " Process " << event.processId << " Thread " << event.threadName << "]: "
+             << getTraceEventName(event.event) << " "
+             << describeTraceArguments(event.event, event.arguments[0], event.arguments[1]) << "\n";
+    }
+}
+
+FlightRecorder::Ring& FlightRecorder::getRing() {
+    if (not ring) {
+        ring = new Ring;
+        std::lock_guard<std::mutex> guard(mutex);
+        copyThreadName(*ring);
+        rings.push_back(ring);
+    }
+    return *ring;
+}
+
+void FlightRecorder::copyThreadName(Ring& ring) {
+    std::fill(std::begin(ring.threadName), std::end(ring.threadName), '\0');
+    threadName.copy(ring.threadName, FLIGHT_RECORDER_THREAD_NAME_SIZE - 1);
+}
+
+void FlightRecorder::dumpingThreadFunction() {
+    while (true) {
+        if (sem_wait(&dumpRequests) < 0 and errno == EINTR) {
+            continue;
+        }
+        dump("SIGUSR1");
+    }
+}
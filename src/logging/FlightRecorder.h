@@ -0,0 +1,84 @@
+#ifndef INC_3PC_FLIGHTRECORDER_H
+#define INC_3PC_FLIGHTRECORDER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <communication/ICommunicator.h>
+#include "Trace.h"
+
+/** Number of the most recent events every thread keeps */
+#define FLIGHT_RECORDER_EVENTS 1024
+#define FLIGHT_RECORDER_THREAD_NAME_SIZE 16
+
+/**
+ * Always-on recorder of the trace events, which keeps the last FLIGHT_RECORDER_EVENTS events of every thread in
+ * memory and writes them out only when something goes wrong: on SIGUSR1, on std::terminate or when asked to by dump().
+ * Recording an event is a handful of relaxed stores into a ring owned by the recording thread, so it is never
+ * disabled. Every dump is appended to 'directory'/flight-RANK.log.
+ */
+class FlightRecorder {
+public:
+
+    /** Installs the SIGUSR1 and terminate handlers, may be called again to change the rank or the directory */
+    static void init(ProcessId rank, const std::string& directory = ".");
+
+    static void record(TraceEvent event, ProcessId processId, LamportTime lamportTime, int64_t argument0,
+                       int64_t argument1);
+
+    /** Names the events of the calling thread in the dumps */
+    static void setThreadName(const std::string& name);
+
+    /** Writes the events of all the threads, ordered by their Lamport timestamps */
+    static void dump(const std::string& reason);
+
+private:
+
+    /**
+     * Kept in relaxed atomic words, so that a dump racing with the recording thread never reads a torn word. Events
+     * mixing the fields of the old and the new one are told apart by reading the head of the ring again afterwards.
+     */
+    struct Slot {
+        std::atomic<int64_t> wallTimeNanos;
+        std::atomic<uint64_t> lamportTime;
+        /** TraceEvent in the lowest 16 bits, ProcessId above */
+        std::atomic<int64_t> eventAndProcess;
+        std::atomic<int64_t> arguments[2];
+    };
+
+    /** Single-producer ring of a thread, stays around after the thread exits as its last events matter the most */
+    struct Ring {
+        std::atomic<uint64_t> head = 0;
+        char threadName[FLIGHT_RECORDER_THREAD_NAME_SIZE] = {};
+        Slot slots[FLIGHT_RECORDER_EVENTS];
+    };
+
+    struct Event {
+        int64_t wallTimeNanos;
+        uint64_t lamportTime;
+        ProcessId processId;
+        TraceEvent event;
+        int64_t arguments[2];
+        const char* threadName;
+    };
+
+    static Ring& getRing();
+
+    /** Has to be called with 'mutex' held, as dumps read the name */
+    static void copyThreadName(Ring& ring);
+
+    /** Waits for the SIGUSR1 handler to post the semaphore, as a signal handler may not write the file itself */
+    static void dumpingThreadFunction();
+
+    static std::mutex mutex;
+    /** Never freed, as detached threads may still record while the program exits */
+    static std::vector<Ring*> rings;
+    static thread_local Ring* ring;
+    static thread_local std::string threadName;
+    static std::atomic<ProcessId> rank;
+    static std::string directory;
+    static std::once_flag handlersInstalled;
+};
+
+#endif //INC_3PC_FLIGHTRECORDER_H
@@ -1,41 +1,356 @@
 #include <mutex>
 #include <util/Define.h>
+#include <util/StringConcat.h>
+#include <util/WaitStrategy.h>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <iomanip>
+#include "FlightRecorder.h"
 #include "Logger.h"
 
 std::mutex Logger::mutex;
-std::map<std::thread::id, std::pair<std::string, rang::fg>> Logger::threads;
-unsigned Logger::logMessageCounter = 0;
-std::function<std::string()> Logger::stateQueryingFunction;
-std::shared_ptr<ICommunicator> Logger::communicator;
-bool Logger::colorsEnabled = true;
+std::deque<std::pair<std::string, rang::fg>> Logger::threads = {{"", rang::fg::reset}};
+std::deque<std::function<std::string(const LogState&)>> Logger::stateFormatters = {nullptr};
+std::vector<std::shared_ptr<Logger::Ring>> Logger::rings;
+std::atomic<unsigned long> Logger::ringsVersion = 0;
+std::atomic<unsigned long> Logger::logMessageCounter = 0;
+std::atomic<unsigned long> Logger::writtenMessageCounter = 0;
+std::shared_ptr<Logger::Context> Logger::globalContext = std::make_shared<Logger::Context>();
+thread_local std::shared_ptr<Logger::Context> Logger::threadContext;
+thread_local unsigned Logger::threadIndex = 0;
+thread_local Logger::RingOwner Logger::ringOwner;
+std::atomic<bool> Logger::colorsEnabled = true;
+std::atomic<LogOverflowPolicy> Logger::overflowPolicy = LogOverflowPolicy::BLOCK;
+std::atomic<LogLevel> Logger::runtimeLevel = LogLevel::DEBUG;
+std::unique_ptr<TraceWriter> Logger::traceWriter;
+std::atomic<bool> Logger::tracingEnabled = false;
+std::map<unsigned long, Logger::Record> Logger::pendingRecords;
+std::once_flag Logger::formattingThreadStarted;
+std::atomic<bool> Logger::formattingThreadRunning = false;
+std::thread Logger::formattingThread;
+std::atomic<bool> Logger::formattingThreadStopping = false;
+std::atomic<bool> Logger::formattingThreadParked = false;
+std::mutex Logger::parkingMutex;
+std::condition_variable Logger::parkingCond;
+
+namespace {
+    /** Upper bound of the time the formatting thread sleeps, in case it misses a wake-up */
+    constexpr auto formattingThreadParkingTime = std::chrono::milliseconds(10);
+    constexpr auto flushTimeout = std::chrono::seconds(1);
+
+    std::terminate_handler previousTerminateHandler;
+}
 
 
 void Logger::init(std::shared_ptr<ICommunicator> communicator) {
-    Logger::communicator = std::move(communicator);
+    globalContext->communicator = std::move(communicator);
+    startFormattingThread();
+    FlightRecorder::init(globalContext->communicator->getProcessId());
+}
+
+void Logger::setContext(std::shared_ptr<Context> context) {
+    threadContext = std::move(context);
+}
+
+std::shared_ptr<Logger::Context> Logger::getContext() {
+    return threadContext ? threadContext : globalContext;
 }
 
 void Logger::registerThread(std::string threadFriendlyName, rang::fg consoleColor) {
     std::lock_guard<std::mutex> guard(mutex);
-    threads[std::this_thread::get_id()] = {std::move(threadFriendlyName), consoleColor};
+    if (threadIndex != 0 and threads[threadIndex] == std::make_pair(threadFriendlyName, consoleColor)) {
+        return;
+    }
+    FlightRecorder::setThreadName(threadFriendlyName);
+    // Entries are never removed, as records of the thread may still be waiting to be formatted
+    threadIndex = static_cast<unsigned>(threads.size());
+    threads.emplace_back(std::move(threadFriendlyName), consoleColor);
 }
 
 void Logger::log(const std::string& message, rang::fg color, rang::style style, rang::bg backgroundColor) {
+    log(LogLevel::INFO, message, color, style, backgroundColor);
+}
+
+void Logger::log(LogLevel level, const std::string& message, rang::fg color, rang::style style,
+                 rang::bg backgroundColor) {
+    if (isEnabled(level)) {
+        write(message, color, style, backgroundColor);
+    }
+}
+
+void Logger::write(const std::string& message, rang::fg color, rang::style style, rang::bg backgroundColor) {
+    Ring& ring = getRing();
+    Record* record = reserveRecord(ring);
+    if (not record) {
+        return;
+    }
+    const Context& context = threadContext ? *threadContext : *globalContext;
+    record->stateFormatter = context.stateFormatter.load(std::memory_order_acquire);
+    if (record->stateFormatter != 0) {
+        record->state = context.state.load();
+    }
+    record->length = static_cast<unsigned short>(message.copy(record->text, LOGGER_RECORD_TEXT_SIZE));
+    record->truncatedBytes = message.size() - record->length;
+    record->color = color;
+    record->style = style;
+    record->backgroundColor = backgroundColor;
+    record->isTraceEvent = false;
+    commitRecord(ring, *record, context);
+}
+
+void Logger::trace(TraceEvent event, int64_t argument0, int64_t argument1) {
+    const Context& context = threadContext ? *threadContext : *globalContext;
+    if (context.communicator) {
+        FlightRecorder::record(event, context.communicator->getProcessId(),
+                               context.communicator->getCurrentLamportTime(), argument0, argument1);
+    }
+    if (not tracingEnabled.load(std::memory_order_acquire)) {
+        return;
+    }
+    Ring& ring = getRing();
+    Record* record = reserveRecord(ring);
+    if (not record) {
+        return;
+    }
+    record->isTraceEvent = true;
+    record->traceEvent = event;
+    record->arguments[0] = argument0;
+    record->arguments[1] = argument1;
+    commitRecord(ring, *record, context);
+}
+
+Logger::Record* Logger::reserveRecord(Ring& ring) {
+    const unsigned long head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= LOGGER_RING_CAPACITY) {
+        // Nobody would ever make room before init()
+        if (overflowPolicy.load(std::memory_order_relaxed) == LogOverflowPolicy::DROP or
+            not formattingThreadRunning.load(std::memory_order_acquire)) {
+            ring.droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+            return head - ring.tail.load(std::memory_order_acquire) < LOGGER_RING_CAPACITY;
+        });
+    }
+    return &ring.records[head % LOGGER_RING_CAPACITY];
+}
+
+void Logger::commitRecord(Ring& ring, Record& record, const Context& context) {
+    record.threadIndex = threadIndex;
+    // Records logged before init() (e.g. by the constructor of the communicator) get the process of init() later on
+    record.processId = context.communicator ? context.communicator->getProcessId() : -1;
+    record.wallTimeNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    // Numbered as late as possible, as the formatting thread waits for every number in turn
+    record.lamportTime = context.communicator ? context.communicator->getCurrentLamportTime() : 0;
+    record.sequenceNumber = logMessageCounter.fetch_add(1, std::memory_order_relaxed);
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+
+    // Pairs with the formatting thread going to sleep - either it sees the record or it is seen parked
+    if (formattingThreadParked.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(parkingMutex);
+        parkingCond.notify_one();
+    }
+}
+
+void Logger::setStateFormatter(std::function<std::string(const LogState&)> stateFormatter) {
     std::lock_guard<std::mutex> guard(mutex);
-    auto [threadId, threadColor] = threads[std::this_thread::get_id()];
-    ProcessId myProcessId = communicator->getProcessId();
-    std::string formattedLamportTime = getFormattedNumber(communicator->getCurrentLamportTime());
-    std::string state = stateQueryingFunction ? stateQueryingFunction() : "";
+    stateFormatters.push_back(std::move(stateFormatter));
+    getContext()->stateFormatter.store(static_cast<unsigned>(stateFormatters.size() - 1), std::memory_order_release);
+}
+
+void Logger::publishState(const LogState& state) {
+    (threadContext ? *threadContext : *globalContext).state.store(state);
+}
+
+void Logger::setColorsEnabled(bool enabled) {
+    colorsEnabled = enabled;
+}
 
-    if (not colorsEnabled) {
-        color = rang::fg::reset;
-        style = rang::style::reset;
-        backgroundColor = rang::bg::reset;
-        threadColor = rang::fg::reset;
+void Logger::setOverflowPolicy(LogOverflowPolicy policy) {
+    overflowPolicy = policy;
+}
+
+void Logger::setLevel(LogLevel level) {
+    runtimeLevel = level;
+}
+
+void Logger::enableTrace(const std::string& directory) {
+    traceWriter = std::make_unique<TraceWriter>(
+            util::concat(directory, "/trace-", globalContext->communicator->getProcessId(), ".bin"));
+    tracingEnabled.store(true, std::memory_order_release);
+}
+
+void Logger::flush() {
+    const unsigned long logged = logMessageCounter.load();
+    WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::now() + flushTimeout, [&]() {
+        return writtenMessageCounter.load() >= logged;
+    });
+}
+
+Logger::RingOwner::~RingOwner() {
+    if (ring) {
+        ring->abandoned.store(true, std::memory_order_release);
+    }
+}
+
+Logger::Ring& Logger::getRing() {
+    if (not ringOwner.ring) {
+        ringOwner.ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> guard(mutex);
+        rings.push_back(ringOwner.ring);
+        ringsVersion.fetch_add(1, std::memory_order_release);
+    }
+    return *ringOwner.ring;
+}
+
+void Logger::startFormattingThread() {
+    std::call_once(formattingThreadStarted, []() {
+        formattingThread = std::thread(formattingThreadFunction);
+        formattingThreadRunning.store(true, std::memory_order_release);
+        // Whatever is still buffered is written out before the program goes down
+        std::atexit([]() {
+            formattingThreadStopping = true;
+            parkingCond.notify_one();
+            formattingThread.join();
+        });
+        previousTerminateHandler = std::set_terminate([]() {
+            flush();
+            previousTerminateHandler ? previousTerminateHandler() : std::abort();
+        });
+    });
+}
+
+void Logger::formattingThreadFunction() {
+    std::vector<std::shared_ptr<Ring>> knownRings;
+    unsigned long knownRingsVersion = ~0ul;
+    unsigned long nextSequenceNumber = 0;
+    while (true) {
+        if (ringsVersion.load(std::memory_order_acquire) != knownRingsVersion) {
+            std::lock_guard<std::mutex> guard(mutex);
+            knownRingsVersion = ringsVersion.load(std::memory_order_relaxed);
+            knownRings = rings;
+        }
+        bool drained = drainRings(knownRings);
+
+        // A missing number belongs to a record which is just being published, so the rest has to wait for it
+        bool written = false;
+        for (auto record = pendingRecords.begin();
+             record != pendingRecords.end() and record->first == nextSequenceNumber; ++nextSequenceNumber) {
+            if (record->second.isTraceEvent) {
+                writeTraceEvent(record->second);
+            } else {
+                format(record->second);
+                written = true;
+            }
+            record = pendingRecords.erase(record);
+        }
+        for (const auto& ring : knownRings) {
+            if (unsigned long dropped = ring->droppedRecords.exchange(0, std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> guard(mutex);
+                std::cout << "[Logger dropped " << dropped << " messages of thread "
+                          << threads[ring->threadIndex].first << "]\n";
+                written = true;
+            }
+        }
+        // The whole batch goes out at once instead of flushing every line
+        if (written) {
+            std::cout.flush();
+        }
+        writtenMessageCounter.store(nextSequenceNumber, std::memory_order_release);
+
+        if (drained) {
+            continue;
+        }
+        if (not pendingRecords.empty()) {
+            // The missing record is just being committed, so it shows up in a moment - in a new ring at worst
+            WaitStrategy::backingOff().waitUntil(std::chrono::steady_clock::time_point::max(), [&]() {
+                return drainRings(knownRings) or ringsVersion.load(std::memory_order_acquire) != knownRingsVersion;
+            });
+            continue;
+        }
+        if (formattingThreadStopping.load()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(parkingMutex);
+        formattingThreadParked.store(true, std::memory_order_seq_cst);
+        if (not drainRings(knownRings) and ringsVersion.load() == knownRingsVersion) {
+            parkingCond.wait_for(lock, formattingThreadParkingTime);
+        }
+        formattingThreadParked.store(false, std::memory_order_relaxed);
     }
-    std::cout << "[TS " << formattedLamportTime << ":" << getFormattedNumber(logMessageCounter++) << " " << getCurrentTime()
-              << " Process " <<  myProcessId << threadColor << " Thread " << threadId << rang::fg::reset << "]: " << state
-              << color << style << backgroundColor << message << rang::style::reset << rang::fg::reset << rang::bg::reset << std::endl;
+}
+
+bool Logger::drainRings(std::vector<std::shared_ptr<Ring>>& rings) {
+    bool drained = false;
+    for (auto ring = rings.begin(); ring != rings.end();) {
+        const bool abandoned = (*ring)->abandoned.load(std::memory_order_acquire);
+        unsigned long tail = (*ring)->tail.load(std::memory_order_relaxed);
+        const unsigned long head = (*ring)->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const Record& record = (*ring)->records[tail % LOGGER_RING_CAPACITY];
+            (*ring)->threadIndex = record.threadIndex;
+            pendingRecords.emplace(record.sequenceNumber, record);
+            drained = true;
+        }
+        (*ring)->tail.store(tail, std::memory_order_release);
+        if (abandoned) {
+            std::lock_guard<std::mutex> guard(mutex);
+            Logger::rings.erase(std::find(Logger::rings.begin(), Logger::rings.end(), *ring));
+            ring = rings.erase(ring);
+        } else {
+            ++ring;
+        }
+    }
+    return drained;
+}
+
+void Logger::format(const Record& record) {
+    std::pair<std::string, rang::fg> thread;
+    const std::function<std::string(const LogState&)>* stateFormatter;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        thread = threads[record.threadIndex];
+        stateFormatter = &stateFormatters[record.stateFormatter];
+    }
+    std::ostream& line = std::cout;
+    const bool colors = colorsEnabled.load(std::memory_order_relaxed);
+    const rang::fg threadColor = colors ? thread.second : rang::fg::reset;
+    const ProcessId processId = record.processId >= 0 ? record.processId : globalContext->communicator->getProcessId();
+    line << "[TS " << getFormattedNumber(record.lamportTime) << ":" << getFormattedNumber(record.sequenceNumber) << " "
+         << getTime(static_cast<std::time_t>(record.wallTimeNanos / 1000000000)) << " Process " << processId << threadColor << " Thread " << thread.first
+         << rang::fg::reset << "]: ";
+    // The state is printed without the colors of the message
+    if (*stateFormatter) {
+        line << (*stateFormatter)(record.state);
+    }
+    if (colors) {
+        line << record.color << record.style << record.backgroundColor;
+    }
+    line << std::string_view(record.text, record.length);
+    if (record.truncatedBytes) {
+        line << "... [" << record.truncatedBytes << " more bytes]";
+    }
+    line << rang::style::reset << rang::fg::reset << rang::bg::reset << '\n';
+}
+
+void Logger::writeTraceEvent(const Record& record) {
+    TraceRecord traceRecord {
+            .lamportTime = record.lamportTime,
+            .sequenceNumber = record.sequenceNumber,
+            .wallTimeNanos = record.wallTimeNanos,
+            .processId = record.processId,
+            .event = record.traceEvent,
+            .reserved = 0,
+            .threadName = {},
+            .arguments = {record.arguments[0], record.arguments[1]}
+    };
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        threads[record.threadIndex].first.copy(traceRecord.threadName, TRACE_THREAD_NAME_SIZE);
+    }
+    traceWriter->append(traceRecord);
 }
 
 std::string Logger::getFormattedNumber(unsigned long number) {
@@ -47,18 +362,10 @@ std::string Logger::getFormattedNumber(unsigned long number) {
     return numberAsString;
 }
 
-std::string Logger::getCurrentTime() {
-    auto t = std::time(nullptr);
-    auto tm = *std::localtime(&t);
+std::string Logger::getTime(std::time_t time) {
+    std::tm tm {};
+    localtime_r(&time, &tm);
     std::stringstream ss;
     ss << std::put_time(&tm, "%H:%M:%S");
     return ss.str();
 }
-
-void Logger::setStateCollector(std::function<std::string()> stateCollector) {
-    stateQueryingFunction = std::move(stateCollector);
-}
-
-void Logger::setColorsEnabled(bool enabled) {
-    colorsEnabled = enabled;
-}
@@ -2,40 +2,241 @@
 #define INC_3PC_LOGGER_H
 
 #include <communication/ICommunicator.h>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
 #include <thread>
+#include <type_traits>
 #include <map>
 #include <mutex>
 #include <functional>
+#include <vector>
+#include <util/SeqLock.h>
 #include "ConsoleColor.h"
+#include "TraceWriter.h"
 
-#define LOGGER_NUMBER_DIGITS 4
+/** Wide enough for the lines of long runs to still sort by their prefix */
+#define LOGGER_NUMBER_DIGITS 8
+/** Number of records every logging thread is able to buffer before the overflow policy kicks in */
+#define LOGGER_RING_CAPACITY 64
+/** Longer messages are truncated, the line then tells how many bytes have been cut off */
+#define LOGGER_RECORD_TEXT_SIZE 200
+/** Number of values a process is able to publish as its state */
+#define LOGGER_STATE_VALUES 6
+/** Messages below this level compile to nothing, e.g. -DLOGGER_MIN_LEVEL=INFO drops the per-packet lines */
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL DEBUG
+#endif
 
+enum class LogLevel : unsigned char {
+    /** Every packet sent and received */
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR
+};
+
+constexpr LogLevel MIN_LOG_LEVEL = LogLevel::LOGGER_MIN_LEVEL;
+
+/** Raw state of a process, copied into every record and only formatted once the record is written out */
+struct LogState {
+    int64_t values[LOGGER_STATE_VALUES];
+};
+
+/** What a logging thread does when its ring is full, as the formatting thread is lagging behind */
+enum class LogOverflowPolicy : unsigned char {
+    /** Waits for the formatting thread, so that nothing gets lost */
+    BLOCK,
+    /** Drops the record, the formatting thread reports how many records were dropped */
+    DROP
+};
+
+/**
+ * Logging threads only fill fixed-size records into rings of their own and a background thread formats and writes
+ * them in batches. Records are numbered by a global counter when they are logged and written out in that order, so
+ * the output looks the same as if every thread wrote its lines straight away. Once tracing is enabled, trace events
+ * travel the same way into a binary trace file, which the TraceMerge tool turns into a single ordered log.
+ */
 class Logger {
 public:
 
+    /**
+     * Everything the logger needs to know about the process a thread belongs to. There is a single global context
+     * in the usual one-process-per-rank setup, but threads simulating different processes in one binary bind their own.
+     */
+    struct Context {
+        std::shared_ptr<ICommunicator> communicator;
+        /** Published by the threads of the process whenever its state changes */
+        SeqLock<LogState> state;
+        /** Index into 'stateFormatters', 0 if the process publishes no state */
+        std::atomic<unsigned> stateFormatter = 0;
+    };
+
+    /** Lines logged before (up to LOGGER_RING_CAPACITY per thread) are written once it is called */
     static void init(std::shared_ptr<ICommunicator> communicator);
 
+    /** Binds the calling thread to the given context instead of the global one */
+    static void setContext(std::shared_ptr<Context> context);
+
+    static std::shared_ptr<Context> getContext();
+
+    /** Logs at the INFO level, the message is built even if the level is disabled - see log<LogLevel::INFO>() */
     static void log(const std::string& message, rang::fg color = rang::fg::reset, rang::style style = rang::style::reset,
                     rang::bg backgroundColor = rang::bg::reset);
 
+    /** For levels only known at runtime, the message is built even if the level is disabled */
+    static void log(LogLevel level, const std::string& message, rang::fg color = rang::fg::reset,
+                    rang::style style = rang::style::reset, rang::bg backgroundColor = rang::bg::reset);
+
+    /**
+     * Only builds the message if the level is enabled, both at compile time and at runtime, so disabled messages cost
+     * a single load of the runtime level at most. 'message' is either a callable returning the message, which is the
+     * way to go whenever building it takes any work (e.g. util::concat), or the message itself.
+     * Usage: Logger::log<LogLevel::INFO>([&]() { return util::concat("Omitted PING from P", p.source); });
+     */
+    template <LogLevel level, typename Message>
+    static void log(Message&& message, rang::fg color = rang::fg::reset, rang::style style = rang::style::reset,
+                    rang::bg backgroundColor = rang::bg::reset) {
+        if constexpr (level >= MIN_LOG_LEVEL) {
+            if (isEnabled(level)) {
+                if constexpr (std::is_invocable_v<Message>) {
+                    write(message(), color, style, backgroundColor);
+                } else {
+                    write(message, color, style, backgroundColor);
+                }
+            }
+        }
+    }
+
+    static bool isEnabled(LogLevel level) {
+        return level >= MIN_LOG_LEVEL and level >= runtimeLevel.load(std::memory_order_relaxed);
+    }
+
+    /** Messages below 'level' are dropped, on top of the ones below LOGGER_MIN_LEVEL */
+    static void setLevel(LogLevel level);
+
     static void registerThread(std::string threadFriendlyName, rang::fg consoleColor = rang::fg::reset);
 
-    static void setStateCollector(std::function<std::string()> stateCollector);
+    /** Makes the lines of the process start with its published state, rendered by 'stateFormatter' */
+    static void setStateFormatter(std::function<std::string(const LogState&)> stateFormatter);
+
+    /** Cheap enough to be called on every change, the state is only formatted along with the lines logged later */
+    static void publishState(const LogState& state);
 
     static void setColorsEnabled(bool enabled);
 
+    static void setOverflowPolicy(LogOverflowPolicy policy);
+
+    /** Starts writing trace events into 'directory'/trace-RANK.bin, has to be called after init() */
+    static void enableTrace(const std::string& directory);
+
+    /** Always recorded by the FlightRecorder, written into the trace file only once tracing has been enabled */
+    static void trace(TraceEvent event, int64_t argument0 = 0, int64_t argument1 = 0);
+
+    /** Waits (for a second at most) until everything logged so far has been written out */
+    static void flush();
+
 
 private:
 
+    struct Record {
+        unsigned long sequenceNumber;
+        LamportTime lamportTime;
+        int64_t wallTimeNanos;
+        ProcessId processId;
+        /** Index into 'threads' */
+        unsigned threadIndex;
+        rang::fg color;
+        rang::style style;
+        rang::bg backgroundColor;
+        /** Index into 'stateFormatters' */
+        unsigned stateFormatter;
+        LogState state;
+        unsigned short length;
+        /** Bytes of the message which did not fit into 'text' */
+        std::size_t truncatedBytes;
+        char text[LOGGER_RECORD_TEXT_SIZE];
+        /** Trace events go to the trace file instead and carry no text */
+        bool isTraceEvent;
+        TraceEvent traceEvent;
+        int64_t arguments[2];
+    };
+
+    /** Single-producer single-consumer ring of a logging thread */
+    struct Ring {
+        /** Only ever written by the logging thread */
+        alignas(64) std::atomic<unsigned long> head = 0;
+        /** Only ever written by the formatting thread */
+        alignas(64) std::atomic<unsigned long> tail = 0;
+        std::atomic<unsigned long> droppedRecords = 0;
+        /** Set once the logging thread has exited, so the ring can go away when it is drained */
+        std::atomic<bool> abandoned = false;
+        unsigned threadIndex = 0;
+        Record records[LOGGER_RING_CAPACITY];
+    };
+
+    /** Owned by every logging thread, abandons its ring when the thread exits */
+    struct RingOwner {
+        std::shared_ptr<Ring> ring;
+
+        ~RingOwner();
+    };
+
+    static void write(const std::string& message, rang::fg color, rang::style style, rang::bg backgroundColor);
+
+    static Ring& getRing();
+
+    /** Applies the overflow policy. @return the record to fill or null if it is to be dropped */
+    static Record* reserveRecord(Ring& ring);
+
+    /** Numbers the filled record and hands it over to the formatting thread */
+    static void commitRecord(Ring& ring, Record& record, const Context& context);
+
+    static void startFormattingThread();
+
+    static void formattingThreadFunction();
+
+    /** Moves every record waiting in the rings to 'pendingRecords'. @return whether there was any */
+    static bool drainRings(std::vector<std::shared_ptr<Ring>>& rings);
+
+    static void format(const Record& record);
+
+    static void writeTraceEvent(const Record& record);
+
     static std::string getFormattedNumber(unsigned long number);
-    static std::string getCurrentTime();
+    static std::string getTime(std::time_t time);
 
+    /** Guards the registration of threads and rings, never taken on the logging path */
     static std::mutex mutex;
-    static std::map<std::thread::id, std::pair<std::string, rang::fg>> threads;
-    static unsigned logMessageCounter;
-    static std::function<std::string()> stateQueryingFunction;
-    static std::shared_ptr<ICommunicator> communicator;
-    static bool colorsEnabled;
+    /** Name and color of every registered thread, the first entry stands for the unregistered ones */
+    static std::deque<std::pair<std::string, rang::fg>> threads;
+    /** Never shrinks either, the first entry stands for the processes which publish no state */
+    static std::deque<std::function<std::string(const LogState&)>> stateFormatters;
+    static std::vector<std::shared_ptr<Ring>> rings;
+    static std::atomic<unsigned long> ringsVersion;
+    static std::atomic<unsigned long> logMessageCounter;
+    static std::atomic<unsigned long> writtenMessageCounter;
+    static std::shared_ptr<Context> globalContext;
+    static thread_local std::shared_ptr<Context> threadContext;
+    static thread_local unsigned threadIndex;
+    static thread_local RingOwner ringOwner;
+    static std::atomic<bool> colorsEnabled;
+    static std::atomic<LogOverflowPolicy> overflowPolicy;
+    static std::atomic<LogLevel> runtimeLevel;
+    static std::unique_ptr<TraceWriter> traceWriter;
+    static std::atomic<bool> tracingEnabled;
+
+    /** Only touched by the formatting thread */
+    static std::map<unsigned long, Record> pendingRecords;
+
+    static std::once_flag formattingThreadStarted;
+    /** Only started by init(), as the records logged before do not know their process yet */
+    static std::atomic<bool> formattingThreadRunning;
+    static std::thread formattingThread;
+    static std::atomic<bool> formattingThreadStopping;
+    static std::atomic<bool> formattingThreadParked;
+    static std::mutex parkingMutex;
+    static std::condition_variable parkingCond;
 };
 
 
@@ -0,0 +1,114 @@
+#ifndef INC_3PC_TRACE_H
+#define INC_3PC_TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <util/Define.h>
+
+/** Layout version of the trace files, bumped whenever TraceRecord changes */
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_THREAD_NAME_SIZE 8
+
+/** Events recorded in the binary trace, the meaning of the arguments is given next to every event */
+enum class TraceEvent : uint16_t {
+    /** Recipient (-1 for all the other processes), message type */
+    SEND,
+    /** Source, message type */
+    RECEIVE,
+    /** Value of the PING token */
+    ENTER_CS,
+    /** Value of the PING token */
+    LEAVE_CS,
+    /** Value the tokens are regenerated from */
+    REGENERATE,
+    /** Value the tokens are incarnated from */
+    INCARNATE,
+    /** Message type of the omitted token, source */
+    OMIT
+};
+
+inline const char* getTraceEventName(TraceEvent event) {
+    switch (event) {
+        case TraceEvent::SEND: return "SEND";
+        case TraceEvent::RECEIVE: return "RECEIVE";
+        case TraceEvent::ENTER_CS: return "ENTER_CS";
+        case TraceEvent::LEAVE_CS: return "LEAVE_CS";
+        case TraceEvent::REGENERATE: return "REGENERATE";
+        case TraceEvent::INCARNATE: return "INCARNATE";
+        case TraceEvent::OMIT: return "OMIT";
+    }
+    return "UNKNOWN";
+}
+
+inline std::string getTraceMessageTypeName(int64_t messageType) {
+    auto name = messageTypeString.find(static_cast<MessageType>(messageType));
+    return name != messageTypeString.end() ? name->second : std::to_string(messageType);
+}
+
+/** Renders the arguments of an event as documented next to it */
+inline std::string describeTraceArguments(TraceEvent event, int64_t argument0, int64_t argument1) {
+    switch (event) {
+        case TraceEvent::SEND:
+            return (argument0 < 0 ? "to all " : "to P" + std::to_string(argument0) + " ") +
+                   getTraceMessageTypeName(argument1);
+        case TraceEvent::RECEIVE:
+            return "from P" + std::to_string(argument0) + " " + getTraceMessageTypeName(argument1);
+        case TraceEvent::OMIT:
+            return getTraceMessageTypeName(argument0) + " from P" + std::to_string(argument1);
+        default:
+            return std::to_string(argument0);
+    }
+}
+
+/** Fixed-size record of a trace file, written in the byte order of the machine */
+struct TraceRecord {
+    uint64_t lamportTime;
+    /** Order in which the records of one file have been logged */
+    uint64_t sequenceNumber;
+    /** Since the epoch of the system clock */
+    int64_t wallTimeNanos;
+    int32_t processId;
+    TraceEvent event;
+    uint16_t reserved;
+    /** Not necessarily null-terminated */
+    char threadName[TRACE_THREAD_NAME_SIZE];
+    int64_t arguments[2];
+
+    /** Records of all the files are ordered by (Lamport time, rank) and by the logging order within a file */
+    bool operator<(const TraceRecord& other) const {
+        if (lamportTime != other.lamportTime) {
+            return lamportTime < other.lamportTime;
+        }
+        if (processId != other.processId) {
+            return processId < other.processId;
+        }
+        return sequenceNumber < other.sequenceNumber;
+    }
+
+    std::string getThreadName() const {
+        return std::string(threadName, strnlen(threadName, TRACE_THREAD_NAME_SIZE));
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<TraceRecord> and sizeof(TraceRecord) == 56,
+              "Trace records are written as their raw bytes");
+
+/** Beginning of every trace file, the records follow right after it */
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    /** Updated after every record, so that the file is readable even if the process gets killed */
+    uint64_t numberOfRecords;
+
+    static constexpr char expectedMagic[8] = {'3', 'P', 'C', 'T', 'R', 'A', 'C', 'E'};
+
+    bool isValid() const {
+        return std::memcmp(magic, expectedMagic, sizeof(magic)) == 0 and version == TRACE_FORMAT_VERSION and
+               recordSize == sizeof(TraceRecord);
+    }
+};
+
+#endif //INC_3PC_TRACE_H
@@ -0,0 +1,66 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "TraceWriter.h"
+
+namespace {
+    int checked(int result, const char* operation) {
+        if (result < 0) {
+            throw std::runtime_error(std::string(operation) + " failed: " + std::strerror(errno));
+        }
+        return result;
+    }
+
+    std::size_t getFileSize(uint64_t numberOfRecords) {
+        return sizeof(TraceFileHeader) + numberOfRecords * sizeof(TraceRecord);
+    }
+}
+
+TraceWriter::TraceWriter(const std::string& path) {
+    fd = checked(open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644), "open");
+    map(TRACE_FILE_INITIAL_RECORDS);
+    TraceFileHeader& fileHeader = header();
+    std::memcpy(fileHeader.magic, TraceFileHeader::expectedMagic, sizeof(fileHeader.magic));
+    fileHeader.version = TRACE_FORMAT_VERSION;
+    fileHeader.recordSize = sizeof(TraceRecord);
+    fileHeader.numberOfRecords = 0;
+}
+
+TraceWriter::~TraceWriter() {
+    const uint64_t numberOfRecords = header().numberOfRecords;
+    munmap(address, size);
+    // Failing to cut the file is harmless, as the header still tells how many records are valid
+    [[maybe_unused]] int result = ftruncate(fd, static_cast<off_t>(getFileSize(numberOfRecords)));
+    close(fd);
+}
+
+void TraceWriter::append(const TraceRecord& record) {
+    uint64_t numberOfRecords = header().numberOfRecords;
+    if (numberOfRecords == capacity) {
+        map(capacity * 2);
+    }
+    auto* records = reinterpret_cast<TraceRecord*>(static_cast<char*>(address) + sizeof(TraceFileHeader));
+    std::memcpy(&records[numberOfRecords], &record, sizeof(record));
+    header().numberOfRecords = numberOfRecords + 1;
+}
+
+void TraceWriter::map(uint64_t newCapacity) {
+    if (address) {
+        munmap(address, size);
+    }
+    size = getFileSize(newCapacity);
+    checked(ftruncate(fd, static_cast<off_t>(size)), "ftruncate");
+    address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        address = nullptr;
+        checked(-1, "mmap");
+    }
+    capacity = newCapacity;
+}
+
+TraceFileHeader& TraceWriter::header() const {
+    return *static_cast<TraceFileHeader*>(address);
+}
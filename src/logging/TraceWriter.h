@@ -0,0 +1,36 @@
+#ifndef INC_3PC_TRACEWRITER_H
+#define INC_3PC_TRACEWRITER_H
+
+#include <string>
+#include "Trace.h"
+
+/** Number of records the trace file is created for, it doubles whenever it fills up */
+#define TRACE_FILE_INITIAL_RECORDS 65536
+
+/** Appends records to a memory-mapped trace file, to be used by a single thread */
+class TraceWriter {
+public:
+
+    explicit TraceWriter(const std::string& path);
+
+    /** Cuts the file down to the records actually written */
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void append(const TraceRecord& record);
+
+private:
+
+    void map(uint64_t capacity);
+
+    TraceFileHeader& header() const;
+
+    int fd = -1;
+    void* address = nullptr;
+    std::size_t size = 0;
+    uint64_t capacity = 0;
+};
+
+#endif //INC_3PC_TRACEWRITER_H
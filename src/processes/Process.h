@@ -27,27 +27,36 @@ public:
     explicit Process(std::shared_ptr<CommunicationManager> monitor)
         :  monitor(std::move(monitor)) {
 
-        Logger::setStateCollector([&] {
+        // Runs on the logging thread, possibly after the process is gone, so it only ever sees the published state
+        Logger::setStateFormatter([processId = this->monitor->getProcessId()](const LogState& state) {
+            Token ping {.value = static_cast<TokenVal>(state.values[0]), .isPresent = state.values[1] != 0};
+            Token pong {.value = static_cast<TokenVal>(state.values[2]), .isPresent = state.values[3] != 0};
             std::stringstream ss;
-            ss << std::setw(2) << std::setfill(' ') << m;
+            ss << std::setw(2) << std::setfill(' ') << state.values[4];
             std::string m = ss.str();
-            auto processId = this->monitor->getProcessId();
             return util::concat("(ping: ", ping.toString(), ", pong: ", pong.toString(),", m: ", m, ")[P", processId, "] ");
         });
+        {
+            std::lock_guard<std::mutex> guard(tokensMutex);
+            publishState();
+        }
 
-        this->monitor->subscribe([](const Packet& p) { return p.messageType == MessageType::CRASH; }, [&](const Packet& p) {
-            if (p.message == "PING") {
+        // Runs on 'tokenExecutor' like the token handlers, so the next token to omit is the next one to arrive
+        this->monitor->subscribe<MessageType::CRASH>([&](const Packet& p, const CrashMessage& crash) {
+            if (crash.token == MessageType::PING) {
                 omitNextPing = true;
-            } else if (p.message == "PONG") {
+            } else if (crash.token == MessageType::PONG) {
                 omitNextPong = true;
             } else {
-                Logger::log("Unexpected packet ");
+                Logger::log<LogLevel::WARNING>("Unexpected packet ");
             }
-        });
+        }, tokenExecutor);
 
         if (this->monitor->getProcessId() == 0) {
+            std::scoped_lock lock(csMutex, tokensMutex);
             ping.isPresent = true;
             pong.isPresent = true;
+            publishState();
             std::thread([&]{
                 while (true) {
                     Logger::registerThread("Input");
@@ -56,41 +65,56 @@ public:
                     std::cin >> token >> process;
                     if (process >= 0 and process < this->monitor->getNumberOfProcesses()) {
                         if (token == 'q') {
-                            Logger::log(util::concat("P", process, " will omit the next PING"));
-                            this->monitor->send(MessageType::CRASH, "PING", process);
+                            Logger::log<LogLevel::INFO>([&]() {
+                                return util::concat("P", process, " will omit the next PING");
+                            });
+                            this->monitor->post<MessageType::CRASH>({.token = MessageType::PING}, process);
                             continue;
                         } else if (token == 'w') {
-                            Logger::log(util::concat("P", process, " will omit the next PONG"));
-                            this->monitor->send(MessageType::CRASH, "PONG", process);
+                            Logger::log<LogLevel::INFO>([&]() {
+                                return util::concat("P", process, " will omit the next PONG");
+                            });
+                            this->monitor->post<MessageType::CRASH>({.token = MessageType::PONG}, process);
                             continue;
                         }
                     }
-                    Logger::log(util::concat("Unexpected input '", process, " ", token,"'", " - ignoring"));
+                    Logger::log<LogLevel::INFO>([&]() {
+                        return util::concat("Unexpected input '", process, " ", token, "'", " - ignoring");
+                    });
                 }
             }).detach();
         }
 
-        this->monitor->subscribe([](const Packet& p) { return p.messageType == MessageType::PING; }, [&](const Packet& p) {
+        // Token handlers may wait for the main thread, so they run on a thread of their own instead of the receiving one
+        this->monitor->subscribe<MessageType::PING>([&](const Packet& p, const TokenMessage& token) {
             if (omitNextPing) {
-                Logger::log(util::concat("Omitted PING from P", p.source));
+                Logger::log<LogLevel::INFO>([&]() {
+                    return util::concat("Omitted PING from P", p.source);
+                });
+                Logger::trace(TraceEvent::OMIT, static_cast<int64_t>(MessageType::PING), p.source);
                 omitNextPing = false;
                 return;
             }
-            if (std::abs(std::stoi(p.message)) < std::abs(m)) {
-                Logger::log("An old ping has arrived - ignoring it", rang::fg::blue);
-                return;
-            }
             std::unique_lock<std::mutex> lock(csMutex);
-            ping = { .value = std::stoi(p.message), .isPresent = true };
             bool pongRegenerated = false;
-            if (m == ping.value) {
-                // PONG got lost
-                regenerate(ping.value);
-                pongRegenerated = true;
-            }
-            if (ping.isPresent and pong.isPresent) {
-                // Both PING and PONG have met in the same process (possibly due to the regeneration)
-                incarnate(ping.value);
+            {
+                // The main thread sends the tokens and updates 'm' meanwhile
+                std::lock_guard<std::mutex> guard(tokensMutex);
+                if (std::abs(token.value) < std::abs(m)) {
+                    Logger::log<LogLevel::INFO>("An old ping has arrived - ignoring it", rang::fg::blue);
+                    return;
+                }
+                ping = { .value = token.value, .isPresent = true };
+                publishState();
+                if (m == ping.value) {
+                    // PONG got lost
+                    regenerate(ping.value);
+                    pongRegenerated = true;
+                }
+                if (ping.isPresent and pong.isPresent) {
+                    // Both PING and PONG have met in the same process (possibly due to the regeneration)
+                    incarnate(ping.value);
+                }
             }
             // Allow the main thread to enter critical section
             csCond.notify_one();
@@ -101,33 +125,41 @@ public:
                    if both tokens exists in the process */
                 sendPong();
             }
-        });
+        }, tokenExecutor);
 
-        this->monitor->subscribe([](const Packet& p) { return p.messageType == MessageType::PONG; }, [&](const Packet& p) {
+        this->monitor->subscribe<MessageType::PONG>([&](const Packet& p, const TokenMessage& token) {
             if (omitNextPong) {
-                Logger::log(util::concat("Omitted PONG from P", p.source), rang::fg::red);
+                Logger::log<LogLevel::INFO>([&]() {
+                    return util::concat("Omitted PONG from P", p.source);
+                }, rang::fg::red);
+                Logger::trace(TraceEvent::OMIT, static_cast<int64_t>(MessageType::PONG), p.source);
                 omitNextPong = false;
                 return;
             }
-            if (std::abs(std::stoi(p.message)) < std::abs(m)) {
-                Logger::log("An old pong has arrived - ignoring it", rang::fg::blue);
-                return;
-            }
-            pong = { .value = std::stoi(p.message), .isPresent = true };
-            if (m == pong.value) {
-                // PING got lost
-                regenerate(pong.value);
-            }
-            if (ping.isPresent and pong.isPresent) {
-                // Both PING and PONG have met in the same process (possibly due to the regeneration)
-                incarnate(ping.value);
-                csCond.notify_one();
+            {
+                // The regeneration writes 'ping', which the main thread waits for under 'csMutex'
+                std::scoped_lock lock(csMutex, tokensMutex);
+                if (std::abs(token.value) < std::abs(m)) {
+                    Logger::log<LogLevel::INFO>("An old pong has arrived - ignoring it", rang::fg::blue);
+                    return;
+                }
+                pong = { .value = token.value, .isPresent = true };
+                publishState();
+                if (m == pong.value) {
+                    // PING got lost
+                    regenerate(pong.value);
+                }
+                if (ping.isPresent and pong.isPresent) {
+                    // Both PING and PONG have met in the same process (possibly due to the regeneration)
+                    incarnate(ping.value);
+                    csCond.notify_one();
+                }
             }
 
             /* We just received pong so we can surely send it. We make sure this operation is delayed until the PING
                is sent if the process has it */
             sendPong();
-        });
+        }, tokenExecutor);
     }
 
     void sendPong() {
@@ -135,7 +167,7 @@ public:
 //        Logger::log("Waiting for ping to clear to send the pong");
         pongCond.wait(lock, [&]() { return not ping.isPresent; });
 //        Logger::log("Ping was sent, so I send pong");
-        send(MessageType::PONG, pong);
+        send<MessageType::PONG>(pong);
     }
 
     void run() {
@@ -145,50 +177,67 @@ public:
             csCond.wait(csLock, [&]() { return ping.isPresent; });
 
             // Enter critical section
-            Logger::log("Entered CS", rang::fg::green);
+            Logger::log<LogLevel::INFO>("Entered CS", rang::fg::green);
+            Logger::trace(TraceEvent::ENTER_CS, ping.value);
             sleep<int>();
-            Logger::log("Left CS", rang::fg::green);
+            Logger::log<LogLevel::INFO>("Left CS", rang::fg::green);
+            Logger::trace(TraceEvent::LEAVE_CS, ping.value);
 
             // Send token(s) to the next process
             std::lock_guard<std::mutex> guard(tokensMutex);
             sleep(1000, 2000);
-            send(MessageType::PING, ping);
+            send<MessageType::PING>(ping);
 
             // Only needed at the start to bootstrap the tokens in the ring
             if (bootstrap && monitor->getProcessId() == 0) {
-                send(MessageType::PONG, pong);
+                send<MessageType::PONG>(pong);
                 bootstrap = false;
             }
             pongCond.notify_one();
         }
     }
 
+    /** Has to be called with both 'csMutex' and 'tokensMutex' held */
     void regenerate(TokenVal value) {
-        std::lock_guard<std::mutex> guard(tokensMutex);
-        Logger::log("REGENERATE", rang::fg::gray);
+        Logger::log<LogLevel::INFO>("REGENERATE", rang::fg::gray);
+        Logger::trace(TraceEvent::REGENERATE, value);
         ping = { .value = std::abs(value), .isPresent = true };
         pong = { .value = -ping.value, .isPresent = true };
+        publishState();
     }
 
+    /** Has to be called with both 'csMutex' and 'tokensMutex' held */
     void incarnate(TokenVal value) {
-        std::lock_guard<std::mutex> guard(tokensMutex);
-        Logger::log("INCARNATE", rang::fg::gray);
+        Logger::log<LogLevel::INFO>("INCARNATE", rang::fg::gray);
+        Logger::trace(TraceEvent::INCARNATE, value);
 //        ping.value = (std::abs(value) + 1) % (monitor->getNumberOfProcesses() + 1);
         ping.value = (std::abs(value) + 1);
         pong.value = -ping.value;
+        publishState();
     }
 
-    void send(MessageType messageType, Token& token) {
+    /** Has to be called with 'tokensMutex' held */
+    template <MessageType messageType>
+    void send(Token& token) {
         if (not token.isPresent) {
             throw std::runtime_error("Tried to send a token that the process does not possess");
         }
         ProcessId nextProcess = (monitor->getProcessId() + 1) % monitor->getNumberOfProcesses();
-        monitor->send(messageType, std::to_string(token.value), nextProcess);
+        monitor->post<messageType>({.value = token.value}, nextProcess);
         token.isPresent = false;
         m = token.value;
+        publishState();
     }
 
 protected:
+    /**
+     * Has to be called whenever the tokens or 'm' change, so that the following log lines show the new state - with
+     * 'tokensMutex' held, as every writer of them holds it, so the snapshot never mixes two changes
+     */
+    void publishState() {
+        Logger::publishState({.values = {ping.value, ping.isPresent, pong.value, pong.isPresent, m}});
+    }
+
     template <typename T>
     void sleep(T min = MIN_SLEEP_TIME, T max = MAX_SLEEP_TIME) {
         std::this_thread::sleep_for(std::chrono::milliseconds(random.randomBetween(min, max)));
@@ -198,10 +247,14 @@ protected:
 
 
 private:
-    /** Misra algorithm variables **/
+    /**
+     * Misra algorithm variables, only read and written with 'tokensMutex' held - 'ping' is written with 'csMutex' held
+     * as well, so that the main thread may wait for it under 'csMutex' alone
+     **/
     Token ping { .value = 1, .isPresent = false };
     Token pong { .value = -1, .isPresent = false };
     TokenVal m = 0; // last sent token value
+    /** Only touched on 'tokenExecutor' */
     bool omitNextPing = false;
     bool omitNextPong = false;
     bool bootstrap = true;
@@ -212,6 +265,12 @@ private:
     std::mutex tokensMutex;
     std::condition_variable pongCond;
 
+    /**
+     * PING, PONG and CRASH handlers share a single thread, so they never run concurrently with each other and handle
+     * the packets in the order they have arrived
+     */
+    std::shared_ptr<IExecutor> tokenExecutor = std::make_shared<SerialExecutor>("Token");
+
     Random random;
 };
 
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <logging/Trace.h>
+
+/** Upper bound of the records held in memory while cutting the input files into sorted runs */
+#define TRACE_MERGE_DEFAULT_CHUNK_RECORDS (1 << 20)
+/** Records read at once from every run while merging them */
+#define TRACE_MERGE_READ_BUFFER_RECORDS 4096
+
+/**
+ * Merges the trace files written by 'Misra83 --trace DIR' into a single stream ordered by (Lamport time, rank) and
+ * renders it as text or CSV. Records within a file are only roughly ordered by their Lamport time, so the files are
+ * first cut into sorted runs of a bounded size, spilled to temporary files, and the runs are then k-way merged.
+ * Memory use therefore stays bounded however big the traces are.
+ *
+ * Usage: TraceMerge [--csv] [--chunk RECORDS] FILE...
+ */
+
+namespace {
+
+    using FilePointer = std::unique_ptr<FILE, int (*)(FILE*)>;
+
+    /** Streams a sorted run of records out of a file */
+    class RunReader {
+    public:
+
+        RunReader(FilePointer file, uint64_t numberOfRecords)
+                : file(std::move(file)), remainingRecords(numberOfRecords) {
+            buffer.reserve(TRACE_MERGE_READ_BUFFER_RECORDS);
+        }
+
+        /** @return false once the run is exhausted */
+        bool next(TraceRecord& record) {
+            if (position == buffer.size() and not refill()) {
+                return false;
+            }
+            record = buffer[position++];
+            return true;
+        }
+
+    private:
+
+        bool refill() {
+            const auto count = static_cast<std::size_t>(
+                    std::min<uint64_t>(remainingRecords, TRACE_MERGE_READ_BUFFER_RECORDS));
+            buffer.resize(count);
+            if (count > 0 and std::fread(buffer.data(), sizeof(TraceRecord), count, file.get()) != count) {
+                throw std::runtime_error("Unexpected end of a trace run");
+            }
+            remainingRecords -= count;
+            position = 0;
+            return count > 0;
+        }
+
+        FilePointer file;
+        uint64_t remainingRecords;
+        std::vector<TraceRecord> buffer;
+        std::size_t position = 0;
+    };
+
+    FilePointer openTrace(const std::string& path, uint64_t& numberOfRecords) {
+        FilePointer file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (not file) {
+            throw std::runtime_error("Cannot open '" + path + "': " + std::strerror(errno));
+        }
+        TraceFileHeader header {};
+        if (std::fread(&header, sizeof(header), 1, file.get()) != 1 or not header.isValid()) {
+            throw std::runtime_error("'" + path + "' is not a trace file of this version");
+        }
+        numberOfRecords = header.numberOfRecords;
+        return file;
+    }
+
+    /** Sorts the chunk and spills it to an anonymous temporary file */
+    RunReader spillRun(std::vector<TraceRecord>& chunk) {
+        std::sort(chunk.begin(), chunk.end());
+        FilePointer run(std::tmpfile(), &std::fclose);
+        if (not run or std::fwrite(chunk.data(), sizeof(TraceRecord), chunk.size(), run.get()) != chunk.size()) {
+            throw std::runtime_error(std::string("Cannot spill a sorted run: ") + std::strerror(errno));
+        }
+        std::rewind(run.get());
+        RunReader reader(std::move(run), chunk.size());
+        chunk.clear();
+        return reader;
+    }
+
+    std::vector<RunReader> createRuns(const std::vector<std::string>& paths, std::size_t chunkRecords) {
+        std::vector<RunReader> runs;
+        std::vector<TraceRecord> chunk;
+        chunk.reserve(chunkRecords);
+        for (const std::string& path : paths) {
+            uint64_t remainingRecords;
+            FilePointer file = openTrace(path, remainingRecords);
+            while (remainingRecords > 0) {
+                const auto count = static_cast<std::size_t>(
+                        std::min<uint64_t>(remainingRecords, chunkRecords - chunk.size()));
+                const std::size_t offset = chunk.size();
+                chunk.resize(offset + count);
+                if (std::fread(chunk.data() + offset, sizeof(TraceRecord), count, file.get()) != count) {
+                    throw std::runtime_error("'" + path + "' is truncated");
+                }
+                remainingRecords -= count;
+                if (chunk.size() == chunkRecords) {
+                    runs.push_back(spillRun(chunk));
+                }
+            }
+        }
+        if (not chunk.empty()) {
+            runs.push_back(spillRun(chunk));
+        }
+        return runs;
+    }
+
+    void printText(const TraceRecord& record) {
+        char wallTime[16];
+        const std::time_t seconds = record.wallTimeNanos / 1000000000;
+        std::tm tm {};
+        localtime_r(&seconds, &tm);
+        std::strftime(wallTime, sizeof(wallTime), "%H:%M:%S", &tm);
+
+        const std::string details = describeTraceArguments(record.event, record.arguments[0], record.arguments[1]);
+        std::printf("[TS %08" PRIu64 " %s.%06" PRId64 " Process %" PRId32 " Thread %s]: %s %s\n", record.lamportTime,
+                    wallTime, record.wallTimeNanos % 1000000000 / 1000, record.processId,
+                    record.getThreadName().c_str(), getTraceEventName(record.event), details.c_str());
+    }
+
+    void printCsv(const TraceRecord& record) {
+        std::printf("%" PRIu64 ",%" PRId32 ",%s,%s,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRIu64 "\n",
+                    record.lamportTime, record.processId, record.getThreadName().c_str(),
+                    getTraceEventName(record.event), record.arguments[0], record.arguments[1], record.wallTimeNanos,
+                    record.sequenceNumber);
+    }
+
+    void merge(std::vector<RunReader>& runs, bool csv) {
+        struct Head {
+            TraceRecord record;
+            std::size_t run;
+
+            bool operator>(const Head& other) const {
+                return other.record < record;
+            }
+        };
+        std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+        for (std::size_t run = 0; run < runs.size(); ++run) {
+            Head head {.record = {}, .run = run};
+            if (runs[run].next(head.record)) {
+                heads.push(head);
+            }
+        }
+        if (csv) {
+            std::printf("lamport_time,process,thread,event,argument0,argument1,wall_time_ns,sequence_number\n");
+        }
+        while (not heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+            csv ? printCsv(head.record) : printText(head.record);
+            if (runs[head.run].next(head.record)) {
+                heads.push(head);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    std::size_t chunkRecords = TRACE_MERGE_DEFAULT_CHUNK_RECORDS;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (std::strcmp(argv[i], "--chunk") == 0 and i + 1 < argc) {
+            chunkRecords = std::max(1ul, std::stoul(argv[++i]));
+        } else {
+            paths.emplace_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--csv] [--chunk RECORDS] FILE..." << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<RunReader> runs = createRuns(paths, chunkRecords);
+        merge(runs, csv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@
 #define MAX_SLEEP_TIME_COORDINATOR 5000
 #define COORDINATOR_ID 0
 #define MPI_CRASH_TAG 100
+#define PREPOSTED_RECEIVES 8
 
 enum State : unsigned char {
     Q, W, A, P ,C
@@ -39,12 +40,18 @@ namespace std {
 }
 
 enum class MessageType : unsigned char {
-    PING, PONG, CRASH
+    PING, PONG, CRASH, REQUEST, REPLY, BATCH
 };
 
+/** BATCH has to stay the last message type */
+constexpr std::size_t NUMBER_OF_MESSAGE_TYPES = static_cast<std::size_t>(MessageType::BATCH) + 1;
+
 const std::map<MessageType, std::string>  messageTypeString = {{MessageType::PING, "PING"},
                                                                {MessageType::PONG, "PONG"},
-                                                               {MessageType::CRASH, "CRASH"}};
+                                                               {MessageType::CRASH, "CRASH"},
+                                                               {MessageType::REQUEST, "REQUEST"},
+                                                               {MessageType::REPLY, "REPLY"},
+                                                               {MessageType::BATCH, "BATCH"}};
 
 inline std::ostream& operator<< (std::ostream& os, MessageType messageType) {
     return os << messageTypeString.at(messageType);
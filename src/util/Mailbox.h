@@ -0,0 +1,64 @@
+#ifndef INC_3PC_MAILBOX_H
+#define INC_3PC_MAILBOX_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "MpscQueue.h"
+
+/**
+ * MpscQueue whose single consumer can block until something arrives. Producers never take the lock unless the
+ * consumer is actually parked, so the common path of a busy consumer stays lock-free.
+ */
+template <typename T>
+class Mailbox {
+public:
+
+    void push(T value) {
+        queue.push(std::move(value));
+        if (consumerParked.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(parkingMutex);
+            parkingCond.notify_one();
+        }
+    }
+
+    std::optional<T> tryPop() {
+        return queue.pop();
+    }
+
+    T pop() {
+        while (true) {
+            if (auto value = queue.pop()) {
+                return std::move(*value);
+            }
+            std::unique_lock<std::mutex> lock(parkingMutex);
+            consumerParked.store(true, std::memory_order_seq_cst);
+            parkingCond.wait(lock, [&]() { return not queue.empty(); });
+            consumerParked.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    std::optional<T> pop(std::chrono::steady_clock::time_point deadline) {
+        while (true) {
+            if (auto value = queue.pop()) {
+                return value;
+            }
+            std::unique_lock<std::mutex> lock(parkingMutex);
+            consumerParked.store(true, std::memory_order_seq_cst);
+            bool arrived = parkingCond.wait_until(lock, deadline, [&]() { return not queue.empty(); });
+            consumerParked.store(false, std::memory_order_relaxed);
+            if (not arrived) {
+                return std::nullopt;
+            }
+        }
+    }
+
+private:
+
+    MpscQueue<T> queue;
+    std::atomic<bool> consumerParked = false;
+    std::mutex parkingMutex;
+    std::condition_variable parkingCond;
+};
+
+#endif //INC_3PC_MAILBOX_H
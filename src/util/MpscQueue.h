@@ -0,0 +1,63 @@
+#ifndef INC_3PC_MPSCQUEUE_H
+#define INC_3PC_MPSCQUEUE_H
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+ * Unbounded lock-free multiple-producer single-consumer queue (Dmitry Vyukov's intrusive MPSC design).
+ * push() may be called from any thread, pop() and empty() only from the single consumer thread.
+ */
+template <typename T>
+class MpscQueue {
+public:
+
+    MpscQueue() : head(new Node), tail(head.load(std::memory_order_relaxed)) { }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (tail) {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    void push(T value) {
+        auto* node = new Node {std::move(value)};
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        // Sequentially consistent so that a consumer going to sleep either sees the node or is seen as sleeping
+        previous->next.store(node, std::memory_order_seq_cst);
+    }
+
+    std::optional<T> pop() {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (not next) {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return value;
+    }
+
+    /** May transiently report an empty queue while a producer is in the middle of push() */
+    bool empty() const {
+        return tail->next.load(std::memory_order_seq_cst) == nullptr;
+    }
+
+private:
+
+    struct Node {
+        std::optional<T> value;
+        std::atomic<Node*> next = nullptr;
+    };
+
+    std::atomic<Node*> head;
+    Node* tail;
+};
+
+#endif //INC_3PC_MPSCQUEUE_H
@@ -0,0 +1,43 @@
+#include "Scheduler.h"
+
+void Scheduler::post(Job job) {
+    jobs.push(std::move(job));
+}
+
+void Scheduler::spawn(Task task) {
+    post([coroutine = task.release()]() { coroutine.resume(); });
+}
+
+void Scheduler::schedule(std::chrono::steady_clock::time_point deadline, Job job) {
+    timers.push(Timer {.deadline = deadline, .sequenceNumber = timerSequenceNumber++, .job = std::move(job)});
+}
+
+Scheduler::SleepAwaiter Scheduler::sleepFor(std::chrono::milliseconds duration) {
+    return SleepAwaiter {.scheduler = *this, .deadline = std::chrono::steady_clock::now() + duration};
+}
+
+void Scheduler::run() {
+    while (not stopped.load()) {
+        fireTimers();
+        if (timers.empty()) {
+            jobs.pop()();
+        } else if (std::optional<Job> job = jobs.pop(timers.top().deadline)) {
+            (*job)();
+        }
+    }
+}
+
+void Scheduler::stop() {
+    // Also wakes the scheduler up if it is waiting for jobs
+    post([this]() { stopped = true; });
+}
+
+void Scheduler::fireTimers() {
+    auto now = std::chrono::steady_clock::now();
+    while (not timers.empty() and timers.top().deadline <= now) {
+        // The job may schedule other timers, so it has to be taken out first
+        Job job = timers.top().job;
+        timers.pop();
+        job();
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef INC_3PC_SCHEDULER_H
+#define INC_3PC_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+#include "Mailbox.h"
+
+/**
+ * Coroutine which starts suspended and, once handed over to Scheduler::spawn(), runs on the thread of the scheduler
+ * until it finishes, when it frees itself. Exceptions escaping the coroutine terminate the program.
+ */
+class Task {
+public:
+
+    struct promise_type {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() { }
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) { }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /** A task which has never been spawned is simply dropped */
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    std::coroutine_handle<> release() {
+        return std::exchange(handle, nullptr);
+    }
+
+private:
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) { }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Single-threaded event loop driving coroutines, so that a single thread may run many logical processes. Jobs may be
+ * posted from any thread, timers and everything else only from the thread running the scheduler - which is where
+ * every coroutine is resumed.
+ */
+class Scheduler {
+public:
+
+    using Job = std::function<void()>;
+
+    /** Suspends the awaiting coroutine until the deadline passes */
+    struct SleepAwaiter {
+        Scheduler& scheduler;
+        std::chrono::steady_clock::time_point deadline;
+
+        bool await_ready() const noexcept {
+            return deadline <= std::chrono::steady_clock::now();
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) {
+            scheduler.schedule(deadline, [coroutine]() { coroutine.resume(); });
+        }
+
+        void await_resume() const noexcept { }
+    };
+
+    /** May be called from any thread */
+    void post(Job job);
+
+    /** Starts the task on the thread of the scheduler, may be called from any thread */
+    void spawn(Task task);
+
+    /** Runs the job once the deadline passes */
+    void schedule(std::chrono::steady_clock::time_point deadline, Job job);
+
+    SleepAwaiter sleepFor(std::chrono::milliseconds duration);
+
+    /** Runs the jobs and timers on the calling thread until stop() */
+    void run();
+
+    /** May be called from any thread */
+    void stop();
+
+private:
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        /** Keeps timers with the same deadline in the order they were scheduled */
+        unsigned long sequenceNumber;
+        Job job;
+
+        bool operator>(const Timer& other) const {
+            return std::tie(deadline, sequenceNumber) > std::tie(other.deadline, other.sequenceNumber);
+        }
+    };
+
+    /** Runs all the timers whose deadline has passed */
+    void fireTimers();
+
+    Mailbox<Job> jobs;
+    std::atomic<bool> stopped = false;
+
+    /** Only touched by the thread running the scheduler */
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers;
+    unsigned long timerSequenceNumber = 0;
+};
+
+#endif //INC_3PC_SCHEDULER_H
@@ -0,0 +1,72 @@
+#ifndef INC_3PC_SEQLOCK_H
+#define INC_3PC_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Holds a small trivially copyable value which readers copy out without ever blocking the writers. The sequence is
+ * odd while a write is in progress, so a reader retries until it gets the same even sequence before and after its
+ * copy. Writers take turns by making the sequence odd themselves. The value is kept in atomic words, so a torn
+ * read is only ever thrown away, never a data race.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock only holds trivially copyable values");
+
+public:
+
+    SeqLock() : SeqLock(T {}) { }
+
+    explicit SeqLock(const T& value) {
+        store(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    void store(const T& value) {
+        uint64_t buffer[numberOfWords] {};
+        std::memcpy(buffer, &value, sizeof(T));
+        uint64_t expected = sequence.load(std::memory_order_relaxed);
+        while (expected % 2 != 0 or not sequence.compare_exchange_weak(expected, expected + 1, std::memory_order_acquire,
+                                                                       std::memory_order_relaxed)) {
+            expected = sequence.load(std::memory_order_relaxed);
+        }
+        // Keeps the words from being written before the sequence turns odd
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < numberOfWords; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(expected + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t buffer[numberOfWords];
+        uint64_t before;
+        uint64_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < numberOfWords; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            // Keeps the words from being read after the sequence is checked again
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before % 2 != 0 or before != after);
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+private:
+
+    static constexpr std::size_t numberOfWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence = 0;
+    std::atomic<uint64_t> words[numberOfWords] {};
+};
+
+#endif //INC_3PC_SEQLOCK_H
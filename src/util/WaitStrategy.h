@@ -0,0 +1,78 @@
+#ifndef INC_3PC_WAITSTRATEGY_H
+#define INC_3PC_WAITSTRATEGY_H
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+/** Longest sleep of a communicator polling for packets, so that an idle link adds little to the next hop */
+#define POLLING_MAX_SLEEP_MICROS 50
+
+/**
+ * Describes how to wait for a condition that can only be polled (e.g. MPI_Test). The waiter spins first, then yields
+ * the processor and finally sleeps with an exponentially growing period, so that an idle waiter does not pin a core
+ * while a short wait still wakes up quickly. Deadlines are measured with the monotonic steady_clock.
+ */
+struct WaitStrategy {
+    unsigned spinIterations;
+    unsigned yieldIterations;
+    std::chrono::microseconds minSleep;
+    std::chrono::microseconds maxSleep;
+
+    /** Lowest wake-up latency at the cost of a fully busy core */
+    static constexpr WaitStrategy spinning() {
+        return {.spinIterations = ~0u, .yieldIterations = 0, .minSleep = {}, .maxSleep = {}};
+    }
+
+    /** Gives the core away on every iteration but never sleeps */
+    static constexpr WaitStrategy yielding() {
+        return {.spinIterations = 100, .yieldIterations = ~0u, .minSleep = {}, .maxSleep = {}};
+    }
+
+    /** Sensible default, especially when more ranks than cores are run on a node */
+    static constexpr WaitStrategy backingOff(std::chrono::microseconds maxSleep = std::chrono::microseconds(1000)) {
+        using namespace std::chrono_literals;
+        return {.spinIterations = 100, .yieldIterations = 100, .minSleep = std::min(10us, maxSleep),
+                .maxSleep = maxSleep};
+    }
+
+    /**
+     * Polls until the predicate returns true or the deadline passes. The predicate is always polled at least once.
+     * @return the last result of the predicate
+     */
+    template <typename Predicate>
+    bool waitUntil(std::chrono::steady_clock::time_point deadline, Predicate predicate) const {
+        using namespace std::chrono;
+        auto sleepTime = minSleep;
+        for (unsigned long iteration = 0; not predicate(); ++iteration) {
+            auto now = steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            if (iteration < spinIterations) {
+                relax();
+            } else if (iteration - spinIterations < yieldIterations) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::min<steady_clock::duration>(sleepTime, deadline - now));
+                sleepTime = std::min(sleepTime * 2, maxSleep);
+            }
+        }
+        return true;
+    }
+
+    template <typename Predicate>
+    bool waitFor(long timeoutMillis, Predicate predicate) const {
+        return waitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis), predicate);
+    }
+
+private:
+
+    static void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+};
+
+#endif //INC_3PC_WAITSTRATEGY_H
@@ -0,0 +1,117 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <communication/CommunicationManager.h>
+#include <communication/MpiOptimizedCommunicator.h>
+#include "Check.h"
+
+/**
+ * Passes PING/PONG between two ranks through CommunicationManager and MpiOptimizedCommunicator, the way Process does,
+ * and checks that once the buffers are warmed up a hop does not allocate at all - neither on the sending nor on the
+ * receiving side. Has to be run with 2 processes.
+ */
+
+#define WARM_UP_HOPS 100
+#define COUNTED_HOPS 1000
+
+namespace {
+    std::atomic<bool> counting = false;
+    std::atomic<unsigned long> allocations = 0;
+
+    void* allocate(std::size_t size, std::size_t alignment) {
+        if (counting.load(std::memory_order_relaxed)) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        void* memory = alignment > alignof(std::max_align_t) ?
+                       std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) :
+                       std::malloc(size ? size : 1);
+        if (not memory) {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    /** Adds the way out of the receiving loop, which otherwise only ends when a packet arrives after the destructor */
+    class StoppableManager : public CommunicationManager {
+    public:
+
+        using CommunicationManager::CommunicationManager;
+
+        /** The receiving thread is woken up by a PING to this very process, which has to be subscribed to */
+        void stop() {
+            terminate = true;
+            post<MessageType::PING>({.value = 0}, getProcessId());
+        }
+    };
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+int main(int argc, char** argv) {
+    auto communicator = std::make_shared<MpiOptimizedCommunicator>(argc, argv, PREPOSTED_RECEIVES);
+    CHECK(communicator->getNumberOfProcesses() == 2);
+    Logger::init(communicator);
+    // Every packet is logged at the DEBUG level, which is meant for debugging and formats the packets
+    Logger::setLevel(LogLevel::INFO);
+    const ProcessId peer = 1 - communicator->getProcessId();
+
+    std::atomic<int> lastValue = 0;
+    {
+        StoppableManager manager(communicator);
+        if (communicator->getProcessId() == 0) {
+            manager.subscribe<MessageType::PONG>([&](const Packet& p, const TokenMessage& token) {
+                lastValue.store(token.value, std::memory_order_release);
+            });
+            manager.subscribe<MessageType::PING>([](const Packet& p, const TokenMessage& token) { });
+        } else {
+            manager.subscribe<MessageType::PING>([&](const Packet& p, const TokenMessage& token) {
+                // The last ping is sent by the process to itself to stop receiving
+                if (p.source == peer) {
+                    manager.post<MessageType::PONG>({.value = token.value}, peer);
+                    // Counts from the end of the warm-up, so that receiving the counted pings is counted as well
+                    counting = token.value >= WARM_UP_HOPS and token.value < WARM_UP_HOPS + COUNTED_HOPS;
+                    lastValue.store(token.value, std::memory_order_release);
+                }
+            });
+        }
+        manager.listen();
+
+        if (communicator->getProcessId() == 0) {
+            for (int value = 1; value <= WARM_UP_HOPS + COUNTED_HOPS + 1; ++value) {
+                counting = value > WARM_UP_HOPS and value <= WARM_UP_HOPS + COUNTED_HOPS;
+                manager.post<MessageType::PING>({.value = value}, peer);
+                while (lastValue.load(std::memory_order_acquire) != value) { }
+            }
+            counting = false;
+        } else {
+            while (lastValue.load(std::memory_order_acquire) != WARM_UP_HOPS + COUNTED_HOPS + 1) { }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        CHECK(allocations.load() == 0);
+        manager.stop();
+    }
+    return 0;
+}
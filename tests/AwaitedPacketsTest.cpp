@@ -0,0 +1,80 @@
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <communication/AwaitedPackets.h>
+#include <communication/Messages.h>
+#include "Check.h"
+
+/**
+ * Drives coroutines on a Scheduler through AwaitedPackets: packets delivered before and while a coroutine awaits them,
+ * nextIf() timing out and a late packet not resuming the coroutine again, and the capacity of the unclaimed packets.
+ * No MPI needed.
+ */
+
+using namespace std::chrono_literals;
+
+namespace {
+    Packet makePacket(MessageType messageType, int32_t value) {
+        return Packet {.lamportTime = 0, .source = 0, .messageType = messageType,
+                       .message = encodeMessage(TokenMessage {.value = value})};
+    }
+
+    PacketPredicate isOfType(MessageType messageType) {
+        return [messageType](const Packet& p) { return p.messageType == messageType; };
+    }
+
+    int32_t valueOf(const Packet& packet) {
+        return decodeMessage<MessageType::PING>(packet).value;
+    }
+
+    /** Exceptions must not escape a Task, so the failed check is handed over to main() */
+    Task awaitPackets(Scheduler& scheduler, AwaitedPackets& packets, std::exception_ptr& failure) {
+        try {
+            // Delivered before anybody awaited it
+            packets.deliver(makePacket(MessageType::PING, 1));
+            CHECK(valueOf(co_await packets.next(isOfType(MessageType::PING))) == 1);
+
+            // Times out with a packet of another type waiting
+            packets.deliver(makePacket(MessageType::PONG, 2));
+            auto start = std::chrono::steady_clock::now();
+            std::optional<Packet> packet = co_await packets.nextIf(isOfType(MessageType::PING), 20ms);
+            CHECK(not packet);
+            CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+            CHECK((co_await packets.nextIf(isOfType(MessageType::PONG), 20ms)).has_value());
+
+            // Delivered from another thread while awaited, the timer firing later on must not resume it again
+            std::thread sender([&scheduler, &packets]() {
+                std::this_thread::sleep_for(10ms);
+                scheduler.post([&packets]() { packets.deliver(makePacket(MessageType::PING, 3)); });
+            });
+            start = std::chrono::steady_clock::now();
+            packet = co_await packets.nextIf(isOfType(MessageType::PING), 200ms);
+            sender.join();
+            CHECK(packet and valueOf(*packet) == 3);
+            CHECK(std::chrono::steady_clock::now() - start < 200ms);
+            co_await scheduler.sleepFor(250ms);
+
+            // The oldest unclaimed packets are dropped beyond the capacity
+            for (int32_t value = 10; value < 16; ++value) {
+                packets.deliver(makePacket(MessageType::PING, value));
+            }
+            CHECK(packets.getDroppedPackets() == 2);
+            CHECK(valueOf(co_await packets.next(isOfType(MessageType::PING))) == 12);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        scheduler.stop();
+    }
+}
+
+int main() {
+    Scheduler scheduler;
+    AwaitedPackets packets(scheduler, 4);
+    std::exception_ptr failure;
+    scheduler.spawn(awaitPackets(scheduler, packets, failure));
+    scheduler.run();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef INC_3PC_CHECK_H
+#define INC_3PC_CHECK_H
+
+#include <stdexcept>
+#include <util/StringConcat.h>
+
+/** Tests are plain executables which fail by throwing, so that a failed check takes down the whole run */
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+inline void check(bool condition, const char* expression, const char* file, int line) {
+    if (not condition) {
+        throw std::runtime_error(util::concat(file, ":", line, ": check '", expression, "' failed"));
+    }
+}
+
+/** Checks that evaluating the expression throws an exception of the given type */
+#define CHECK_THROWS(exception, expression) checkThrows<exception>([&]() { expression; }, #expression, __FILE__, __LINE__)
+
+template <typename Exception, typename Expression>
+inline void checkThrows(Expression expression, const char* text, const char* file, int line) {
+    try {
+        expression();
+    } catch (const Exception&) {
+        return;
+    }
+    throw std::runtime_error(util::concat(file, ":", line, ": '", text, "' has not thrown"));
+}
+
+#endif //INC_3PC_CHECK_H
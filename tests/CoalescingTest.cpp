@@ -0,0 +1,139 @@
+#include <cstring>
+#include <memory>
+#include <string>
+#include <communication/CoalescingCommunicator.h>
+#include <communication/Messages.h>
+#include "Check.h"
+#include "LoopbackCommunicator.h"
+
+/**
+ * Packs packets into BATCH packets through CoalescingCommunicator on top of a LoopbackCommunicator and unpacks them
+ * again: the order, timestamps and payloads survive, full batches leave right away, and truncated or corrupt batches
+ * are rejected as a whole. No MPI needed.
+ */
+
+namespace {
+    /** Nothing is flushed by time during the test */
+    const CoalescingWindow window {.delay = std::chrono::seconds(60), .maxBatchBytes = 4096, .maxBatchPackets = 3};
+
+    const long timeoutMillis = 1000;
+
+    /** Size of the header of a record, see CoalescingCommunicator.cpp */
+    constexpr std::size_t recordHeaderSize = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+    Packet receiveOrThrow(ICommunicator& communicator) {
+        std::optional<Packet> packet = communicator.receive(timeoutMillis);
+        CHECK(packet.has_value());
+        return std::move(*packet);
+    }
+
+    /** Posts two packets and flushes them as a single batch, which is taken off the loopback */
+    Packet makeBatch() {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CoalescingCommunicator coalescing(loopback, window);
+        coalescing.post(MessageType::PING, encodeMessage(TokenMessage {.value = 7}), 1);
+        coalescing.post(MessageType::CRASH, encodeMessage(CrashMessage {.token = MessageType::PONG}), 1);
+        coalescing.flush();
+        Packet batch = receiveOrThrow(*loopback);
+        CHECK(batch.messageType == MessageType::BATCH);
+        return batch;
+    }
+
+    void testRoundTrip() {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CoalescingCommunicator coalescing(loopback, window);
+        const std::string big(100, 'x');
+        const LamportTime first = coalescing.post(MessageType::PING, encodeMessage(TokenMessage {.value = 1}), 1);
+        const LamportTime second = coalescing.post(MessageType::PONG, std::string_view(), 1);
+        CHECK(second > first);
+        CHECK(loopback->pending() == 0);
+        // The third packet fills the batch, which leaves without waiting for the window
+        coalescing.post(MessageType::REQUEST, big, 1);
+        CHECK(loopback->pending() == 1);
+        coalescing.post(MessageType::PING, encodeMessage(TokenMessage {.value = 2}), 1);
+        coalescing.flush();
+        CHECK(loopback->pending() == 2);
+
+        Packet packet = receiveOrThrow(coalescing);
+        CHECK(packet.messageType == MessageType::PING and decodeMessage<MessageType::PING>(packet).value == 1);
+        CHECK(packet.source == 0);
+        CHECK(packet.lamportTime > first);
+        packet = receiveOrThrow(coalescing);
+        CHECK(packet.messageType == MessageType::PONG and packet.message.empty());
+        packet = receiveOrThrow(coalescing);
+        CHECK(packet.messageType == MessageType::REQUEST and packet.message == big);
+        packet = receiveOrThrow(coalescing);
+        CHECK(decodeMessage<MessageType::PING>(packet).value == 2);
+        CHECK(not coalescing.receive(timeoutMillis / 10));
+
+        const CoalescingStatistics statistics = coalescing.getStatistics();
+        CHECK(statistics.batchesSent == 2 and statistics.packetsSent == 4);
+        CHECK(statistics.batchesFlushedBySize == 1 and statistics.batchesFlushedByTime == 0);
+        CHECK(statistics.maxPacketsInBatch == 3);
+        CHECK(statistics.batchesReceived == 2 and statistics.packetsReceived == 4);
+    }
+
+    /** A broken batch throws and leaves none of its packets behind, the next one is received as usual */
+    void checkRejected(const Packet& malformed) {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CoalescingCommunicator coalescing(loopback, window);
+        loopback->inject(malformed);
+        CHECK_THROWS(std::runtime_error, coalescing.receive(timeoutMillis));
+
+        loopback->inject(makeBatch());
+        CHECK(decodeMessage<MessageType::PING>(receiveOrThrow(coalescing)).value == 7);
+        CHECK(decodeMessage<MessageType::CRASH>(receiveOrThrow(coalescing)).token == MessageType::PONG);
+        CHECK(not coalescing.receive(timeoutMillis / 10));
+    }
+
+    void testMalformedBatches() {
+        const Packet batch = makeBatch();
+        const std::string records(batch.message.view());
+
+        Packet truncated = batch;
+        truncated.message = std::string_view(records).substr(0, records.size() - 1);
+        checkRejected(truncated);
+
+        Packet truncatedHeader = batch;
+        truncatedHeader.message = std::string_view(records).substr(0, recordHeaderSize - 1);
+        checkRejected(truncatedHeader);
+
+        Packet trailing = batch;
+        trailing.message = records + "abc";
+        checkRejected(trailing);
+
+        // The message length of the first record points far past the end of the batch
+        std::string overlong = records;
+        const uint32_t length = 0xfffffff0;
+        std::memcpy(overlong.data() + sizeof(uint64_t) + sizeof(uint8_t), &length, sizeof(length));
+        Packet tooLong = batch;
+        tooLong.message = overlong;
+        checkRejected(tooLong);
+
+        for (uint8_t type : {static_cast<uint8_t>(MessageType::BATCH), static_cast<uint8_t>(NUMBER_OF_MESSAGE_TYPES)}) {
+            std::string wrongType = records;
+            std::memcpy(wrongType.data() + sizeof(uint64_t), &type, sizeof(type));
+            Packet corrupt = batch;
+            corrupt.message = wrongType;
+            checkRejected(corrupt);
+        }
+    }
+
+    /** Packets of senders which do not coalesce pass through untouched */
+    void testPlainPackets() {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CoalescingCommunicator coalescing(loopback, window);
+        loopback->inject(Packet {.lamportTime = 5, .source = 1, .messageType = MessageType::PONG,
+                                 .message = encodeMessage(TokenMessage {.value = -3})});
+        const Packet packet = receiveOrThrow(coalescing);
+        CHECK(packet.source == 1 and decodeMessage<MessageType::PONG>(packet).value == -3);
+        CHECK(coalescing.getStatistics().batchesReceived == 0);
+    }
+}
+
+int main() {
+    testRoundTrip();
+    testMalformedBatches();
+    testPlainPackets();
+    return 0;
+}
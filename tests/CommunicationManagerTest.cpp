@@ -0,0 +1,139 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <communication/CommunicationManager.h>
+#include "Check.h"
+#include "LoopbackCommunicator.h"
+
+/**
+ * Subscribes and unsubscribes while a CommunicationManager on top of a LoopbackCommunicator dispatches: unsubscribe()
+ * waits for a callback which is still running and no callback runs once it has returned, neither inline nor from an
+ * executor which has the packet queued already. Callbacks subscribing and unsubscribing from within the dispatch
+ * exercise the deferred deletion of the replaced registries. Awaiting packets has to be enabled before coroutines may
+ * await them. No MPI needed.
+ */
+
+using namespace std::chrono_literals;
+
+namespace {
+    /** Generous, as the callbacks run on threads of their own */
+    const auto timeout = 5s;
+
+    void waitFor(const std::atomic<bool>& flag) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (not flag) {
+            CHECK(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+
+    void waitFor(const std::atomic<unsigned>& counter, unsigned value) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (counter < value) {
+            CHECK(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+
+    Packet makePacket(MessageType messageType) {
+        return Packet {.lamportTime = 0, .source = 1, .messageType = messageType, .message = {}};
+    }
+
+    /**
+     * The callback blocks on the first packet while more packets reach the subscription - queued at the executor,
+     * or waiting for the receiving thread if the callback is called inline
+     */
+    void testUnsubscribeWaitsForCallback(const std::shared_ptr<IExecutor>& executor) {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CommunicationManager manager(loopback);
+        // Every packet has to reach some callback, or the dispatch fails
+        std::atomic<unsigned> dispatched = 0;
+        manager.subscribe([](const Packet&) { return true; }, [&](const Packet&) { ++dispatched; });
+
+        std::atomic<bool> entered = false, released = false, returned = false, callbackAfterReturn = false;
+        std::atomic<unsigned> calls = 0;
+        SubscriptionId id = manager.subscribe(MessageType::PING, [&](const Packet&) {
+            ++calls;
+            callbackAfterReturn = callbackAfterReturn or returned;
+            entered = true;
+            waitFor(released);
+        }, executor);
+        manager.listen();
+        for (int i = 0; i < 3; ++i) {
+            loopback->inject(makePacket(MessageType::PING));
+        }
+        waitFor(entered);
+
+        std::thread unsubscriber([&]() {
+            manager.unsubscribe(id);
+            returned = true;
+        });
+        std::this_thread::sleep_for(50ms);
+        CHECK(not returned);
+        released = true;
+        unsubscriber.join();
+
+        // The packets left behind still get dispatched, to the remaining subscription only
+        loopback->inject(makePacket(MessageType::PING));
+        waitFor(dispatched, 4);
+        if (executor) {
+            // Drains the packets queued before the unsubscription
+            std::atomic<bool> drained = false;
+            executor->execute(MessageType::PING, [&]() { drained = true; });
+            waitFor(drained);
+        }
+        CHECK(calls == 1);
+        CHECK(not callbackAfterReturn);
+    }
+
+    /** Inline callbacks change the subscriptions of the very dispatch which reads the registry they replace */
+    void testSubscribeFromCallback() {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CommunicationManager manager(loopback);
+        std::atomic<unsigned> outerCalls = 0, innerCalls = 0, pongCalls = 0;
+        SubscriptionId outer = 0;
+        outer = manager.subscribe(MessageType::PING, [&](const Packet&) {
+            if (++outerCalls == 1) {
+                // Subscribed during the dispatch, so it only gets the next packets
+                manager.subscribe(MessageType::PING, [&](const Packet&) { ++innerCalls; });
+                manager.subscribe([](const Packet& p) { return p.messageType == MessageType::PONG; },
+                                  [&](const Packet&) { ++pongCalls; });
+            } else {
+                // Unsubscribing itself must not wait for itself to finish
+                manager.unsubscribe(outer);
+            }
+        });
+        manager.listen();
+
+        loopback->inject(makePacket(MessageType::PING));
+        waitFor(outerCalls, 1);
+        loopback->inject(makePacket(MessageType::PING));
+        waitFor(innerCalls, 1);
+        loopback->inject(makePacket(MessageType::PING));
+        waitFor(innerCalls, 2);
+        loopback->inject(makePacket(MessageType::PONG));
+        waitFor(pongCalls, 1);
+        CHECK(outerCalls == 2);
+        CHECK(innerCalls == 2);
+    }
+
+    void testAwaitingNotEnabled() {
+        auto loopback = std::make_shared<LoopbackCommunicator>();
+        CommunicationManager manager(loopback);
+        CHECK_THROWS(std::logic_error, manager.next(MessageType::PING));
+        CHECK_THROWS(std::logic_error, manager.nextIf([](const Packet&) { return true; }, 10ms));
+
+        Scheduler scheduler;
+        manager.enableAwaiting(scheduler, [](const Packet&) { return true; });
+        CHECK_THROWS(std::logic_error, manager.enableAwaiting(scheduler, [](const Packet&) { return true; }));
+    }
+}
+
+int main() {
+    testUnsubscribeWaitsForCallback(nullptr);
+    testUnsubscribeWaitsForCallback(std::make_shared<SerialExecutor>("Callback"));
+    testSubscribeFromCallback();
+    testAwaitingNotEnabled();
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <string>
+#include <communication/Messages.h>
+#include <communication/MpiOptimizedCommunicator.h>
+#include "Check.h"
+
+/**
+ * Round trips of the payloads through PacketPayload, the typed messages and the frames of MpiOptimizedCommunicator,
+ * with the payload sizes around PACKET_INLINE_PAYLOAD_SIZE, where PacketPayload switches from the inline buffer
+ * to the heap.
+ */
+
+namespace {
+    /** Distinct bytes, so that a payload copied from a wrong offset does not compare equal */
+    std::string makeBytes(std::size_t size, char first = 'a') {
+        std::string bytes(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<char>(first + i % 26);
+        }
+        return bytes;
+    }
+
+    bool isInline(const PacketPayload& payload) {
+        const char* data = payload.data();
+        const auto* begin = reinterpret_cast<const char*>(&payload);
+        return data >= begin and data < begin + sizeof(payload);
+    }
+
+    void testPayloadCopiesAndMoves(std::size_t size) {
+        const std::string bytes = makeBytes(size);
+        PacketPayload payload(bytes);
+        CHECK(payload.size() == size);
+        CHECK(payload == bytes);
+        CHECK(isInline(payload) == (size <= PACKET_INLINE_PAYLOAD_SIZE));
+
+        PacketPayload copy(payload);
+        CHECK(copy == bytes);
+        CHECK(payload == bytes);
+
+        PacketPayload moved(std::move(copy));
+        CHECK(moved == bytes);
+        CHECK(copy.empty());
+
+        PacketPayload assigned;
+        assigned = moved;
+        CHECK(assigned == bytes);
+        PacketPayload moveAssigned(makeBytes(PACKET_INLINE_PAYLOAD_SIZE * 2, 'A'));
+        moveAssigned = std::move(assigned);
+        CHECK(moveAssigned == bytes);
+
+        moveAssigned = moveAssigned;
+        CHECK(moveAssigned == bytes);
+    }
+
+    /** Reassigning a payload crosses the boundary in both directions and reuses the heap buffer once it has one */
+    void testPayloadReassignment() {
+        const std::string small = makeBytes(PACKET_INLINE_PAYLOAD_SIZE);
+        const std::string big = makeBytes(PACKET_INLINE_PAYLOAD_SIZE + 1, 'A');
+        const std::string bigger = makeBytes(PACKET_INLINE_PAYLOAD_SIZE * 4, 'a');
+
+        PacketPayload payload(small);
+        CHECK(isInline(payload));
+        payload = PacketPayload(big);
+        CHECK(payload == big);
+        CHECK(not isInline(payload));
+
+        payload.assign(small.data(), small.size());
+        CHECK(payload == small);
+        CHECK(isInline(payload));
+
+        payload.assign(bigger.data(), bigger.size());
+        const char* heapBuffer = payload.data();
+        payload.assign(big.data(), big.size());
+        CHECK(payload == big);
+        CHECK(payload.data() == heapBuffer);
+
+        // Assigning a part of the payload itself
+        payload.assign(payload.data() + 1, PACKET_INLINE_PAYLOAD_SIZE);
+        CHECK(payload == std::string_view(big).substr(1));
+        payload.assign(nullptr, 0);
+        CHECK(payload.empty());
+    }
+
+    void testTypedMessages() {
+        const TokenMessage token {.value = -42};
+        Packet ping {.lamportTime = 7, .source = 3, .messageType = MessageType::PING, .message = encodeMessage(token)};
+        CHECK(decodeMessage<MessageType::PING>(ping).value == -42);
+        CHECK(describeMessage(MessageType::PING, ping.message) == "-42");
+
+        const CrashMessage crash {.token = MessageType::PONG};
+        Packet crashPacket {.lamportTime = 1, .source = 0, .messageType = MessageType::CRASH,
+                            .message = encodeMessage(crash)};
+        CHECK(decodeMessage<MessageType::CRASH>(crashPacket).token == MessageType::PONG);
+
+        CHECK_THROWS(std::runtime_error, decodeMessage<MessageType::PONG>(ping));
+        ping.message = std::string_view("abc");
+        CHECK_THROWS(std::runtime_error, decodeMessage<MessageType::PING>(ping));
+    }
+
+    void testCorrelatedMessages(std::size_t size) {
+        const std::string message = makeBytes(size);
+        const Packet request {.lamportTime = 9, .source = 2, .messageType = MessageType::REQUEST,
+                              .message = wrapCorrelated(123456789, MessageType::PING, message)};
+        CHECK(request.message.size() == CORRELATION_HEADER_SIZE + size);
+
+        const Packet unwrapped = unwrapCorrelated(request);
+        CHECK(unwrapped.correlationId == 123456789);
+        CHECK(unwrapped.messageType == MessageType::PING);
+        CHECK(unwrapped.message == message);
+        CHECK(unwrapped.lamportTime == request.lamportTime);
+        CHECK(unwrapped.source == request.source);
+
+        Packet truncated = request;
+        truncated.message = request.message.view().substr(0, CORRELATION_HEADER_SIZE - 1);
+        CHECK_THROWS(std::runtime_error, unwrapCorrelated(truncated));
+
+        // Wrapped types which are out of range or envelopes themselves
+        for (std::size_t wrappedType : {static_cast<std::size_t>(MessageType::REQUEST),
+                                         static_cast<std::size_t>(MessageType::REPLY),
+                                         static_cast<std::size_t>(MessageType::BATCH), NUMBER_OF_MESSAGE_TYPES,
+                                         std::size_t {255}}) {
+            Packet malformed {.lamportTime = 9, .source = 2, .messageType = MessageType::REQUEST,
+                              .message = wrapCorrelated(1, static_cast<MessageType>(wrappedType), message)};
+            CHECK_THROWS(std::runtime_error, unwrapCorrelated(malformed));
+        }
+    }
+
+    void testFrames(std::size_t size) {
+        const std::string message = makeBytes(size);
+        std::string frame;
+        const std::size_t frameSize = MpiOptimizedCommunicator::encode(frame, 1234567890123, MessageType::PONG, message);
+        CHECK(frameSize == MpiOptimizedCommunicator::getFrameSize(message));
+        CHECK(frame.size() >= frameSize);
+
+        // Decoding into packets which already hold an inline and a heap payload
+        for (std::size_t previousSize : {std::size_t {1}, std::size_t {MPI_MAX_FRAME_SIZE * 2}}) {
+            Packet packet {.lamportTime = 0, .source = 0, .messageType = MessageType::PING,
+                           .message = makeBytes(previousSize, 'A')};
+            MpiOptimizedCommunicator::decode(frame.data(), frameSize, 5, packet);
+            CHECK(packet.lamportTime == 1234567890123);
+            CHECK(packet.source == 5);
+            CHECK(packet.messageType == MessageType::PONG);
+            CHECK(packet.message == message);
+
+            const Packet copied = MpiOptimizedCommunicator::getPacket(frame.substr(0, frameSize), 5);
+            CHECK(copied == packet);
+            CHECK(copied.lamportTime == packet.lamportTime);
+        }
+    }
+}
+
+int main() {
+    for (std::size_t size : {std::size_t {0}, std::size_t {1}, sizeof(TokenMessage),
+                             std::size_t {PACKET_INLINE_PAYLOAD_SIZE - 1}, std::size_t {PACKET_INLINE_PAYLOAD_SIZE},
+                             std::size_t {PACKET_INLINE_PAYLOAD_SIZE + 1}, std::size_t {MPI_MAX_FRAME_SIZE}}) {
+        testPayloadCopiesAndMoves(size);
+        testCorrelatedMessages(size);
+        testFrames(size);
+    }
+    testPayloadReassignment();
+    testTypedMessages();
+    return 0;
+}
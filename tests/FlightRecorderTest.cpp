@@ -0,0 +1,75 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <logging/FlightRecorder.h>
+#include "Check.h"
+
+/**
+ * Dumps the flight recorder over and over while another thread keeps recording into it and checks that every dumped
+ * event is whole: all the fields of an event are derived from its number, so an event mixing the fields of an old and
+ * a new one shows up as a mismatch. No MPI needed.
+ */
+
+#define DUMPS 200
+
+namespace {
+    /** Parses "[TS 00000042 12:34:56.789 Process 42 Thread Recorder]: ENTER_CS 42" */
+    void checkEvent(const std::string& line) {
+        std::istringstream fields(line);
+        std::string ts, time, process, thread, threadName, event;
+        uint64_t lamportTime;
+        int64_t processId, argument;
+        fields >> ts >> lamportTime >> time >> process >> processId >> thread >> threadName >> event >> argument;
+        CHECK(fields and ts == "[TS" and event == "ENTER_CS");
+        CHECK(threadName == "Recorder]:");
+        CHECK(processId == static_cast<int64_t>(lamportTime % 1000));
+        CHECK(argument == static_cast<int64_t>(lamportTime));
+    }
+}
+
+int main() {
+    char directory[] = "/tmp/FlightRecorderTest-XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    FlightRecorder::init(0, directory);
+
+    std::atomic<bool> started = false;
+    std::atomic<bool> stopped = false;
+    std::thread recorder([&]() {
+        FlightRecorder::setThreadName("Recorder");
+        for (uint64_t number = 1; not stopped.load(std::memory_order_relaxed); ++number) {
+            FlightRecorder::record(TraceEvent::ENTER_CS, static_cast<ProcessId>(number % 1000), number,
+                                   static_cast<int64_t>(number), 0);
+            started.store(true, std::memory_order_relaxed);
+        }
+    });
+    while (not started.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+    }
+    for (int dump = 0; dump < DUMPS; ++dump) {
+        FlightRecorder::dump("test");
+    }
+    stopped = true;
+    recorder.join();
+
+    const std::string path = std::string(directory) + "/flight-0.log";
+    std::ifstream file(path);
+    std::string line;
+    unsigned long dumps = 0, events = 0;
+    while (std::getline(file, line)) {
+        if (line.rfind("-----", 0) == 0) {
+            ++dumps;
+        } else {
+            checkEvent(line);
+            ++events;
+        }
+    }
+    CHECK(dumps == DUMPS);
+    CHECK(events > 0);
+    std::remove(path.c_str());
+    std::remove(directory);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <communication/InboundQueue.h>
+#include "Check.h"
+
+/**
+ * Overfills small InboundQueues under every OverflowPolicy and checks which packets survive, in which order, and what
+ * the per-type statistics say about them: depth, drops, spills and the time spent queued. No MPI needed.
+ */
+
+using namespace std::chrono_literals;
+
+namespace {
+    /** The Lamport time tells the packets apart */
+    Packet makePacket(MessageType messageType, LamportTime number) {
+        return Packet {.lamportTime = number, .source = 1, .messageType = messageType, .message = {}};
+    }
+
+    Packet popOrThrow(InboundQueue& queue) {
+        std::optional<Packet> packet = queue.pop(std::chrono::steady_clock::now() + 1s);
+        CHECK(packet.has_value());
+        return std::move(*packet);
+    }
+
+    /** Pops everything there is and checks it against the expected packets, in order */
+    void checkContents(InboundQueue& queue, const std::vector<std::pair<MessageType, LamportTime>>& expected) {
+        for (auto [messageType, number] : expected) {
+            Packet packet = popOrThrow(queue);
+            CHECK(packet.messageType == messageType and packet.lamportTime == number);
+        }
+        CHECK(not queue.pop(std::chrono::steady_clock::now() + 10ms));
+    }
+
+    /** The receiving thread waits for room and nothing gets lost */
+    void testBlock() {
+        InboundQueue queue({.capacity = 2, .overflowPolicy = OverflowPolicy::BLOCK});
+        queue.push(makePacket(MessageType::PING, 1));
+        queue.push(makePacket(MessageType::PING, 2));
+        std::atomic<bool> pushed = false;
+        std::thread receiver([&]() {
+            queue.push(makePacket(MessageType::PING, 3));
+            pushed = true;
+        });
+        std::this_thread::sleep_for(50ms);
+        CHECK(not pushed);
+        CHECK(queue.getStatistics(MessageType::PING).depth == 2);
+
+        CHECK(popOrThrow(queue).lamportTime == 1);
+        receiver.join();
+        CHECK(pushed);
+        checkContents(queue, {{MessageType::PING, 2}, {MessageType::PING, 3}});
+
+        const InboundStatistics statistics = queue.getStatistics(MessageType::PING);
+        CHECK(statistics.enqueued == 3 and statistics.dispatched == 3 and statistics.depth == 0);
+        CHECK(statistics.maxDepth == 2);
+        CHECK(statistics.dropped == 0 and statistics.spilled == 0);
+        // The first two packets have waited for the whole time the receiver was blocked
+        CHECK(statistics.maxLatency >= 50ms and statistics.totalLatency >= 100ms);
+
+        // Closing the queue releases a receiver blocked on a full queue
+        queue.push(makePacket(MessageType::PING, 4));
+        queue.push(makePacket(MessageType::PING, 5));
+        std::thread blocked([&]() { queue.push(makePacket(MessageType::PING, 6)); });
+        std::this_thread::sleep_for(10ms);
+        queue.close();
+        blocked.join();
+        CHECK(not queue.pop(std::chrono::steady_clock::now() + 10ms));
+    }
+
+    /** The oldest packet of the same type makes room, an arriving packet of a type which is not queued is dropped */
+    void testDropOldest() {
+        InboundQueue queue({.capacity = 3, .overflowPolicy = OverflowPolicy::DROP_OLDEST});
+        queue.push(makePacket(MessageType::PING, 1));
+        queue.push(makePacket(MessageType::PONG, 2));
+        queue.push(makePacket(MessageType::PING, 3));
+        queue.push(makePacket(MessageType::PING, 4));
+        queue.push(makePacket(MessageType::PONG, 5));
+        queue.push(makePacket(MessageType::REQUEST, 6));
+
+        InboundStatistics ping = queue.getStatistics(MessageType::PING);
+        CHECK(ping.depth == 2 and ping.maxDepth == 2 and ping.enqueued == 3 and ping.dropped == 1);
+        InboundStatistics pong = queue.getStatistics(MessageType::PONG);
+        CHECK(pong.depth == 1 and pong.maxDepth == 1 and pong.enqueued == 2 and pong.dropped == 1);
+        InboundStatistics request = queue.getStatistics(MessageType::REQUEST);
+        CHECK(request.depth == 0 and request.enqueued == 0 and request.dropped == 1);
+
+        checkContents(queue, {{MessageType::PING, 3}, {MessageType::PING, 4}, {MessageType::PONG, 5}});
+        ping = queue.getStatistics(MessageType::PING);
+        CHECK(ping.depth == 0 and ping.dispatched == 2 and ping.spilled == 0);
+        CHECK(queue.getStatistics(MessageType::PONG).dispatched == 1);
+        CHECK(queue.getStatistics(MessageType::REQUEST).dispatched == 0);
+    }
+
+    /** Nothing is lost or reordered, the spilled packets count into the depth until they are dispatched */
+    void testSpill() {
+        InboundQueue queue({.capacity = 2, .overflowPolicy = OverflowPolicy::SPILL});
+        for (LamportTime number = 1; number <= 4; ++number) {
+            queue.push(makePacket(MessageType::PING, number));
+        }
+        queue.push(makePacket(MessageType::PONG, 5));
+        InboundStatistics ping = queue.getStatistics(MessageType::PING);
+        CHECK(ping.depth == 4 and ping.maxDepth == 4 and ping.enqueued == 4 and ping.spilled == 2);
+        CHECK(queue.getStatistics(MessageType::PONG).spilled == 1);
+
+        std::this_thread::sleep_for(20ms);
+        CHECK(popOrThrow(queue).lamportTime == 1);
+        // There is room in the queue again, but the packet still has to wait behind the spilled ones
+        queue.push(makePacket(MessageType::PING, 6));
+        checkContents(queue, {{MessageType::PING, 2}, {MessageType::PING, 3}, {MessageType::PING, 4},
+                              {MessageType::PONG, 5}, {MessageType::PING, 6}});
+
+        ping = queue.getStatistics(MessageType::PING);
+        CHECK(ping.depth == 0 and ping.maxDepth == 4 and ping.enqueued == 5 and ping.dispatched == 5);
+        CHECK(ping.spilled == 3 and ping.dropped == 0);
+        CHECK(ping.maxLatency >= 20ms);
+        const InboundStatistics pong = queue.getStatistics(MessageType::PONG);
+        CHECK(pong.depth == 0 and pong.dispatched == 1 and pong.dropped == 0);
+    }
+}
+
+int main() {
+    testBlock();
+    testDropOldest();
+    testSpill();
+    return 0;
+}
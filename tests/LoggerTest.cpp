@@ -0,0 +1,37 @@
+#include <string>
+#include <logging/Logger.h>
+#include "Check.h"
+
+/**
+ * Checks that the messages of the disabled levels are never built - neither the ones below LOGGER_MIN_LEVEL nor the
+ * ones below the runtime level. Nothing is written out, as Logger is not initialized. No MPI needed.
+ */
+
+namespace {
+    template <LogLevel level>
+    bool isBuilt() {
+        bool built = false;
+        Logger::log<level>([&]() {
+            built = true;
+            return std::string("message");
+        });
+        return built;
+    }
+}
+
+int main() {
+    Logger::setLevel(LogLevel::WARNING);
+    CHECK(not isBuilt<LogLevel::DEBUG>());
+    CHECK(not isBuilt<LogLevel::INFO>());
+    CHECK(isBuilt<LogLevel::WARNING>() == (LogLevel::WARNING >= MIN_LOG_LEVEL));
+    CHECK(isBuilt<LogLevel::ERROR>() == (LogLevel::ERROR >= MIN_LOG_LEVEL));
+
+    Logger::setLevel(LogLevel::DEBUG);
+    CHECK(isBuilt<LogLevel::DEBUG>() == (LogLevel::DEBUG >= MIN_LOG_LEVEL));
+    CHECK(isBuilt<LogLevel::INFO>() == (LogLevel::INFO >= MIN_LOG_LEVEL));
+    CHECK(Logger::isEnabled(LogLevel::DEBUG) == (LogLevel::DEBUG >= MIN_LOG_LEVEL));
+
+    // Plain messages take the same path
+    Logger::log<LogLevel::INFO>("message");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef INC_3PC_LOOPBACKCOMMUNICATOR_H
+#define INC_3PC_LOOPBACKCOMMUNICATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <communication/ICommunicator.h>
+
+#define RECEIVE_POLL_MILLIS 10
+
+/**
+ * Communicator of a single process which receives everything that is sent, whoever the recipient is, so that the layers
+ * on top of a communicator are tested without MPI. Packets may also be injected as if they came from someone else.
+ */
+class LoopbackCommunicator : public ICommunicator {
+public:
+
+    explicit LoopbackCommunicator(ProcessId processId = 0, ProcessId numberOfProcesses = 2) {
+        myProcessId = processId;
+        this->numberOfProcesses = numberOfProcesses;
+        for (ProcessId id = 0; id < numberOfProcesses; ++id) {
+            if (id != processId) {
+                otherProcesses.insert(id);
+            }
+        }
+    }
+
+    Packet send(MessageType messageType, const std::string& message,
+                const std::unordered_set<ProcessId>& recipients) override {
+        Packet packet {.lamportTime = tickLamportTime(), .source = myProcessId, .messageType = messageType,
+                       .message = message};
+        for (std::size_t i = 0; i < recipients.size(); ++i) {
+            inject(packet);
+        }
+        return packet;
+    }
+
+    Packet receive() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return not inbox.empty(); });
+        return take();
+    }
+
+    std::optional<Packet> receive(long timeoutMillis) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (not cond.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [&]() { return not inbox.empty(); })) {
+            return std::nullopt;
+        }
+        return take();
+    }
+
+    /** Gives up now and then, so that a CommunicationManager receiving through it notices it is being destroyed */
+    void receive(const PacketConsumer& consumer) override {
+        if (std::optional<Packet> packet = receive(RECEIVE_POLL_MILLIS)) {
+            consumer(*packet);
+        }
+    }
+
+    void inject(const Packet& packet) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inbox.push_back(packet);
+        }
+        cond.notify_one();
+    }
+
+    std::size_t pending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inbox.size();
+    }
+
+private:
+
+    /** Has to be called with 'mutex' held */
+    Packet take() {
+        Packet packet = std::move(inbox.front());
+        inbox.pop_front();
+        packet.lamportTime = mergeLamportTime(packet.lamportTime);
+        return packet;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Packet> inbox;
+};
+
+#endif //INC_3PC_LOOPBACKCOMMUNICATOR_H
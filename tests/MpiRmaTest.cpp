@@ -0,0 +1,108 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <communication/Messages.h>
+#include <communication/MpiRmaCommunicator.h>
+#include "Check.h"
+
+/**
+ * Passes packets between two ranks through MpiRmaCommunicator: round trips through the window, which reuse every slot
+ * many times over, a burst overfilling the ring of the recipient, which the sender has to wait out, and packets taking
+ * the two-sided path because they are too big for a slot or tagged. Has to be run with 2 processes.
+ */
+
+#define ROUND_TRIPS 1000
+#define BURST (4 * MPI_RMA_SLOTS)
+#define TEST_TAG 7
+
+namespace {
+    const long timeoutMillis = 5000;
+
+    Packet receiveOrThrow(ICommunicator& communicator) {
+        std::optional<Packet> packet = communicator.receive(timeoutMillis);
+        CHECK(packet.has_value());
+        return std::move(*packet);
+    }
+
+    int32_t valueOf(const Packet& packet) {
+        if (packet.messageType == MessageType::PONG) {
+            return decodeMessage<MessageType::PONG>(packet).value;
+        }
+        return decodeMessage<MessageType::PING>(packet).value;
+    }
+
+    std::string encodeValue(int32_t value) {
+        return std::string(encodeMessage(TokenMessage {.value = value}));
+    }
+
+    void testRoundTrips(MpiRmaCommunicator& communicator, ProcessId peer) {
+        for (int32_t value = 1; value <= ROUND_TRIPS; ++value) {
+            if (communicator.getProcessId() == 0) {
+                const LamportTime sent = communicator.send(MessageType::PING, encodeValue(value), peer).lamportTime;
+                Packet packet = receiveOrThrow(communicator);
+                CHECK(packet.source == peer and packet.messageType == MessageType::PONG and valueOf(packet) == -value);
+                CHECK(packet.lamportTime > sent);
+            } else {
+                Packet packet = receiveOrThrow(communicator);
+                CHECK(packet.source == peer and packet.messageType == MessageType::PING and valueOf(packet) == value);
+                communicator.send(MessageType::PONG, encodeValue(-value), peer);
+            }
+        }
+    }
+
+    /** The sender waits for the recipient to consume the frames, which arrive complete and in order */
+    void testBurst(MpiRmaCommunicator& communicator, ProcessId peer) {
+        if (communicator.getProcessId() == 0) {
+            for (int32_t value = 0; value < BURST; ++value) {
+                communicator.send(MessageType::PING, encodeValue(value), peer);
+            }
+        } else {
+            // Gives the sender the time to fill the ring
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            for (int32_t value = 0; value < BURST; ++value) {
+                CHECK(valueOf(receiveOrThrow(communicator)) == value);
+            }
+        }
+    }
+
+    /** Neither of them fits into the window, the tagged one is only taken by a receive of its tag */
+    void testTwoSidedPath(MpiRmaCommunicator& communicator, ProcessId peer) {
+        const std::string big(2 * MPI_RMA_SLOT_SIZE, 'x');
+        if (communicator.getProcessId() == 0) {
+            communicator.send(MessageType::REQUEST, encodeValue(1), peer, TEST_TAG);
+            communicator.send(MessageType::REQUEST, big, peer);
+            communicator.send(MessageType::PING, encodeValue(2), peer);
+        } else {
+            Packet tagged = communicator.receive(TEST_TAG);
+            CHECK(tagged.messageType == MessageType::REQUEST and tagged.message == encodeValue(1));
+            // The big packet and the window frame travel separately, so their order is not given
+            bool bigReceived = false, windowReceived = false;
+            for (int i = 0; i < 2; ++i) {
+                Packet packet = receiveOrThrow(communicator);
+                if (packet.messageType == MessageType::REQUEST) {
+                    CHECK(packet.message == big);
+                    bigReceived = true;
+                } else {
+                    CHECK(valueOf(packet) == 2);
+                    windowReceived = true;
+                }
+            }
+            CHECK(bigReceived and windowReceived);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    MpiRmaCommunicator communicator(argc, argv);
+    CHECK(communicator.getNumberOfProcesses() == 2);
+    const ProcessId peer = 1 - communicator.getProcessId();
+
+    testRoundTrips(communicator, peer);
+    MPI_Barrier(MPI_COMM_WORLD);
+    testBurst(communicator, peer);
+    MPI_Barrier(MPI_COMM_WORLD);
+    testTwoSidedPath(communicator, peer);
+    MPI_Barrier(MPI_COMM_WORLD);
+    CHECK(not communicator.receive(10L));
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <communication/Messages.h>
+#include <communication/ShmRingCommunicator.h>
+#include "Check.h"
+
+/**
+ * Runs both ends of a ShmRingCommunicator link in a single process, one thread each: a round trip of tokens, a burst
+ * overfilling the ring, which the sender has to wait out, and a receiver which has given up spinning and sleeps on the
+ * futex until the sender rings the doorbell. No MPI needed.
+ */
+
+#define ROUND_TRIPS 1000
+#define BURST (4 * SHM_RING_SLOTS)
+
+using namespace std::chrono_literals;
+
+namespace {
+    /** Lets the test see whether the receiver sleeps on the futex */
+    class ObservedShmRingCommunicator : public ShmRingCommunicator {
+    public:
+        using ShmRingCommunicator::ShmRingCommunicator;
+
+        bool isSleeping() const {
+            return inbound.header().consumerSleeping.load() != 0;
+        }
+    };
+
+    const long timeoutMillis = 5000;
+
+    Packet receiveOrThrow(ICommunicator& communicator) {
+        std::optional<Packet> packet = communicator.receive(timeoutMillis);
+        CHECK(packet.has_value());
+        return std::move(*packet);
+    }
+
+    int32_t valueOf(const Packet& packet) {
+        if (packet.messageType == MessageType::PONG) {
+            return decodeMessage<MessageType::PONG>(packet).value;
+        }
+        return decodeMessage<MessageType::PING>(packet).value;
+    }
+
+    void sendValue(ICommunicator& communicator, MessageType messageType, int32_t value) {
+        communicator.send(messageType, std::string(encodeMessage(TokenMessage {.value = value})),
+                          1 - communicator.getProcessId());
+    }
+
+    void testRoundTrips(ICommunicator& first, ICommunicator& second) {
+        std::thread echo([&]() {
+            for (int i = 0; i < ROUND_TRIPS; ++i) {
+                Packet packet = receiveOrThrow(second);
+                CHECK(packet.source == first.getProcessId() and packet.messageType == MessageType::PING);
+                sendValue(second, MessageType::PONG, -valueOf(packet));
+            }
+        });
+        for (int32_t value = 1; value <= ROUND_TRIPS; ++value) {
+            const LamportTime sent = first.getCurrentLamportTime();
+            sendValue(first, MessageType::PING, value);
+            Packet packet = receiveOrThrow(first);
+            CHECK(packet.messageType == MessageType::PONG and valueOf(packet) == -value);
+            CHECK(packet.lamportTime > sent + 1);
+        }
+        echo.join();
+    }
+
+    /** The sender waits for the receiver to make room in the ring, nothing is lost or reordered */
+    void testBurst(ICommunicator& first, ICommunicator& second) {
+        std::thread sender([&]() {
+            for (int32_t value = 0; value < BURST; ++value) {
+                sendValue(first, MessageType::PING, value);
+            }
+        });
+        std::this_thread::sleep_for(20ms);
+        for (int32_t value = 0; value < BURST; ++value) {
+            CHECK(valueOf(receiveOrThrow(second)) == value);
+        }
+        sender.join();
+        CHECK(not second.receive(10));
+    }
+
+    void testFutexWakeUp(ICommunicator& first, ObservedShmRingCommunicator& second) {
+        std::atomic<bool> received = false;
+        std::chrono::steady_clock::time_point receivedAt;
+        std::thread receiver([&]() {
+            CHECK(valueOf(receiveOrThrow(second)) == 42);
+            receivedAt = std::chrono::steady_clock::now();
+            received = true;
+        });
+        // Far longer than SHM_SPIN_MICROS, so the receiver has to be asleep by now
+        const auto deadline = std::chrono::steady_clock::now() + 1s;
+        while (not second.isSleeping()) {
+            CHECK(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::sleep_for(1ms);
+        }
+        std::this_thread::sleep_for(10ms);
+        CHECK(not received and second.isSleeping());
+
+        const auto sentAt = std::chrono::steady_clock::now();
+        sendValue(first, MessageType::PING, 42);
+        receiver.join();
+        // Woken up by the doorbell rather than by the timeout of the futex
+        CHECK(receivedAt - sentAt < std::chrono::milliseconds(timeoutMillis / 5));
+        CHECK(not second.isSleeping());
+    }
+}
+
+int main() {
+    char directory[] = "/tmp/ShmRingTest-XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    {
+        // Both ends wait for each other to create their segments
+        std::unique_ptr<ObservedShmRingCommunicator> communicators[2];
+        std::thread other([&]() { communicators[1] = std::make_unique<ObservedShmRingCommunicator>(directory, 2); });
+        communicators[0] = std::make_unique<ObservedShmRingCommunicator>(directory, 2);
+        other.join();
+        if (communicators[0]->getProcessId() != 0) {
+            std::swap(communicators[0], communicators[1]);
+        }
+        ObservedShmRingCommunicator& first = *communicators[0];
+        ObservedShmRingCommunicator& second = *communicators[1];
+        CHECK(second.getProcessId() == 1);
+
+        testRoundTrips(first, second);
+        testBurst(first, second);
+        testFutexWakeUp(first, second);
+        testFutexWakeUp(second, first);
+    }
+    for (const char* claim : {"/claim-0", "/claim-1"}) {
+        std::remove((std::string(directory) + claim).c_str());
+    }
+    std::remove(directory);
+    return 0;
+}
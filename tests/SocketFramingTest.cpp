@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <communication/Messages.h>
+#include <communication/MpiOptimizedCommunicator.h>
+#include <communication/SocketCommunicator.h>
+#include "Check.h"
+
+/**
+ * Writes raw frames to the socket of a single-process SocketCommunicator: well-formed frames are received, while a
+ * frame whose length cannot even hold the headers or exceeds SOCKET_MAX_FRAME_SIZE gets the connection closed instead
+ * of being decoded or waited for. No MPI needed.
+ */
+
+namespace {
+    const long timeoutMillis = 200;
+
+    /** Connects to the communicator like another process would and introduces itself as process 'source' */
+    int connectAs(const std::string& path, EncodedProcessId source) {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        CHECK(fd >= 0);
+        CHECK(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+        CHECK(write(fd, &source, sizeof(source)) == sizeof(source));
+        return fd;
+    }
+
+    /** Writes just the length of a frame, optionally followed by a well-formed frame of that length */
+    void writeFrame(int fd, EncodedNextPacketLength length, bool withBody = false) {
+        std::string frame(sizeof(length), '\0');
+        std::memcpy(frame.data(), &length, sizeof(length));
+        if (withBody) {
+            const SocketTag tag = SOCKET_DEFAULT_TAG;
+            frame.append(reinterpret_cast<const char*>(&tag), sizeof(tag));
+            const std::string message(encodeMessage(TokenMessage {.value = 5}));
+            std::string encoded(MpiOptimizedCommunicator::getFrameSize(message), '\0');
+            MpiOptimizedCommunicator::encode(encoded.data(), 1, MessageType::PING, message);
+            frame += encoded;
+            CHECK(frame.size() == sizeof(length) + length);
+        }
+        CHECK(write(fd, frame.data(), frame.size()) == static_cast<ssize_t>(frame.size()));
+    }
+
+    EncodedNextPacketLength validLength() {
+        return static_cast<EncodedNextPacketLength>(
+                sizeof(SocketTag) + MpiOptimizedCommunicator::getFrameSize(encodeMessage(TokenMessage {.value = 5})));
+    }
+
+    /** The communicator has closed its end once a read sees the end of the stream */
+    bool isClosedByPeer(int fd) {
+        char byte;
+        return read(fd, &byte, sizeof(byte)) == 0;
+    }
+
+    void testMalformedLength(SocketCommunicator& communicator, const std::string& path,
+                             EncodedNextPacketLength length) {
+        int fd = connectAs(path, 1);
+        writeFrame(fd, validLength(), true);
+        writeFrame(fd, length);
+        std::optional<Packet> packet = communicator.receive(timeoutMillis);
+        CHECK(packet and packet->source == 1 and decodeMessage<MessageType::PING>(*packet).value == 5);
+        CHECK(not communicator.receive(timeoutMillis));
+        CHECK(isClosedByPeer(fd));
+        close(fd);
+    }
+}
+
+int main() {
+    char directory[] = "/tmp/SocketFramingTest-XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    const std::string path = std::string(directory) + "/socket-0";
+    {
+        SocketCommunicator communicator(directory, 1);
+        testMalformedLength(communicator, path, 0);
+        // One byte short of the tag and the header of the packet
+        testMalformedLength(communicator, path, static_cast<EncodedNextPacketLength>(
+                sizeof(SocketTag) + MpiOptimizedCommunicator::getFrameSize({}) - 1));
+        testMalformedLength(communicator, path, SOCKET_MAX_FRAME_SIZE);
+
+        // A frame of the maximal size would be waited for, so the connection stays open
+        int fd = connectAs(path, 1);
+        writeFrame(fd, SOCKET_MAX_FRAME_SIZE - sizeof(EncodedNextPacketLength));
+        CHECK(not communicator.receive(timeoutMillis));
+        close(fd);
+    }
+    std::remove((std::string(directory) + "/claim-0").c_str());
+    std::remove(directory);
+    return 0;
+}
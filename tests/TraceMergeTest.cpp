@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <logging/Trace.h>
+#include <logging/TraceWriter.h>
+#include "Check.h"
+
+/**
+ * Writes the traces of two ranks, whose records are only roughly ordered by their Lamport time, and merges them with
+ * the TraceMerge tool given as the argument. Small chunks force the records through several sorted runs; the CSV has
+ * to list every record once, ordered by (Lamport time, rank, sequence number), with all of its fields intact.
+ * No MPI needed.
+ */
+
+namespace {
+    /** Lamport time and sequence number of the records of one rank, in the order they are logged */
+    using Trace = std::vector<std::pair<uint64_t, uint64_t>>;
+
+    /** Derives the fields of a record from its position, so that the merged output can be checked field by field */
+    TraceRecord makeRecord(int32_t processId, uint64_t lamportTime, uint64_t sequenceNumber) {
+        TraceRecord record {};
+        record.lamportTime = lamportTime;
+        record.sequenceNumber = sequenceNumber;
+        record.wallTimeNanos = 1000 * processId + static_cast<int64_t>(sequenceNumber);
+        record.processId = processId;
+        record.event = TraceEvent::RECEIVE;
+        std::string("Recv").copy(record.threadName, TRACE_THREAD_NAME_SIZE);
+        record.arguments[0] = 1 - processId;
+        record.arguments[1] = static_cast<int64_t>(sequenceNumber);
+        return record;
+    }
+
+    void writeTrace(const std::string& path, int32_t processId, const Trace& trace) {
+        TraceWriter writer(path);
+        for (auto [lamportTime, sequenceNumber] : trace) {
+            writer.append(makeRecord(processId, lamportTime, sequenceNumber));
+        }
+    }
+
+    /** @return standard output of the command, which has to succeed */
+    std::string run(const std::string& command) {
+        FILE* pipe = popen(command.c_str(), "r");
+        CHECK(pipe != nullptr);
+        std::string output;
+        char buffer[4096];
+        for (std::size_t read; (read = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0;) {
+            output.append(buffer, read);
+        }
+        CHECK(pclose(pipe) == 0);
+        return output;
+    }
+
+    void checkCsv(const std::string& csv, const Trace& first, const Trace& second) {
+        std::vector<std::tuple<uint64_t, int32_t, uint64_t>> expected;
+        for (auto [lamportTime, sequenceNumber] : first) {
+            expected.emplace_back(lamportTime, 0, sequenceNumber);
+        }
+        for (auto [lamportTime, sequenceNumber] : second) {
+            expected.emplace_back(lamportTime, 1, sequenceNumber);
+        }
+        std::sort(expected.begin(), expected.end());
+
+        std::istringstream lines(csv);
+        std::string line;
+        CHECK(std::getline(lines, line).good());
+        CHECK(line == "lamport_time,process,thread,event,argument0,argument1,wall_time_ns,sequence_number");
+        for (auto [lamportTime, processId, sequenceNumber] : expected) {
+            CHECK(std::getline(lines, line).good());
+            const TraceRecord record = makeRecord(processId, lamportTime, sequenceNumber);
+            std::ostringstream expectedLine;
+            expectedLine << record.lamportTime << ',' << record.processId << ",Recv,RECEIVE," << record.arguments[0]
+                         << ',' << record.arguments[1] << ',' << record.wallTimeNanos << ',' << record.sequenceNumber;
+            CHECK(line == expectedLine.str());
+        }
+        CHECK(std::getline(lines, line).fail());
+    }
+}
+
+int main(int argc, char** argv) {
+    CHECK(argc == 2);
+    const std::string traceMerge = argv[1];
+    char directory[] = "/tmp/TraceMergeTest-XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    const std::string firstPath = std::string(directory) + "/trace-0.bin";
+    const std::string secondPath = std::string(directory) + "/trace-1.bin";
+
+    // Equal Lamport times across the ranks and within a rank, records of a rank logged out of the Lamport order
+    const Trace first = {{1, 0}, {3, 1}, {2, 2}, {5, 3}, {5, 4}, {4, 5}, {7, 6}};
+    const Trace second = {{2, 0}, {1, 1}, {5, 2}, {4, 3}, {6, 4}, {5, 5}};
+    writeTrace(firstPath, 0, first);
+    writeTrace(secondPath, 1, second);
+
+    for (const char* chunk : {"1", "3", "1000"}) {
+        checkCsv(run(traceMerge + " --csv --chunk " + chunk + " " + firstPath + " " + secondPath), first, second);
+        // The order of the files does not matter
+        checkCsv(run(traceMerge + " --csv --chunk " + chunk + " " + secondPath + " " + firstPath), first, second);
+    }
+
+    // The text output has one line per record too
+    const std::string text = run(traceMerge + " " + firstPath + " " + secondPath);
+    std::istringstream lines(text);
+    std::string line;
+    std::size_t numberOfLines = 0;
+    while (std::getline(lines, line)) {
+        CHECK(line.find(" RECEIVE from P") != std::string::npos);
+        ++numberOfLines;
+    }
+    CHECK(numberOfLines == first.size() + second.size());
+
+    // Files which are not traces are refused
+    CHECK(std::system((traceMerge + " " + directory + " > /dev/null 2>&1").c_str()) != 0);
+
+    std::remove(firstPath.c_str());
+    std::remove(secondPath.c_str());
+    std::remove(directory);
+    return 0;
+}